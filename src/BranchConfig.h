@@ -0,0 +1,31 @@
+#include <inttypes.h>
+
+//How the fetch stage guesses the direction of a conditional branch whose operands are not
+//ready when it reaches decode.
+enum BranchPredictorType
+{
+    //No prediction: decode stalls until the operands can be forwarded.
+    NO_PREDICTION,
+    //Always falls through.
+    STATIC_NOT_TAKEN,
+    //A 2-bit counter per branch PC.
+    BIMODAL,
+    //2-bit counters indexed by the branch PC xor the global branch history.
+    GSHARE,
+    //Bimodal and gshare side by side, with a per-PC chooser between them.
+    TOURNAMENT
+};
+
+struct BranchPredictorConfig
+{
+    //Direction predictor.
+    BranchPredictorType type = NO_PREDICTION;
+    //2-bit counters in each predictor table.
+    uint32_t tableSize = 1024;
+    //Global history bits for gshare and tournament.
+    uint32_t historyBits = 10;
+    //Branch target buffer entries, for jr targets other than returns.
+    uint32_t btbEntries = 64;
+    //Return address stack depth, for jal and jr $ra.
+    uint32_t rasDepth = 8;
+};
@@ -0,0 +1,118 @@
+#include <stddef.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_SIMD_SWAP 1
+#endif
+
+//Buffer-wide counterparts of ConvertWordToBigEndian and ConvertHalfWordToBigEndian, for moving
+//whole runs of memory at once: count words (or half words) are converted between big-endian
+//bytes in memory order and host values. Neither buffer needs to be aligned, and they may be
+//the same buffer. The byte reversal is picked once, at the first call, from what the CPU
+//supports: 32 bytes per AVX2 shuffle, 16 per SSSE3 shuffle, or one value at a time.
+
+typedef void (*ByteSwapFunction)(uint8_t *dst, const uint8_t *src, size_t count);
+
+//Reverses the bytes of each of count T-sized values in src, into dst.
+template<typename T>
+inline void byteSwapScalar(uint8_t *dst, const uint8_t *src, size_t count)
+{
+    for(size_t i = 0 ; i < count ; i++, dst += sizeof(T), src += sizeof(T))
+    {
+        T value;
+        memcpy(&value, src, sizeof(T));
+        value = sizeof(T) == 4 ? __builtin_bswap32(value) : __builtin_bswap16(value);
+        memcpy(dst, &value, sizeof(T));
+    }
+}
+
+#ifdef HAVE_SIMD_SWAP
+//The pshufb control reversing each T-sized lane of a 16 byte vector.
+template<typename T>
+inline __attribute__((target("ssse3"))) __m128i byteSwapMask()
+{
+    if(sizeof(T) == 4)
+    {
+        return _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    }
+    return _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+}
+
+template<typename T>
+__attribute__((target("ssse3"))) void byteSwapSsse3(uint8_t *dst, const uint8_t *src, size_t count)
+{
+    const __m128i mask = byteSwapMask<T>();
+    size_t bytes = count * sizeof(T);
+    size_t i = 0;
+    for( ; i + 16 <= bytes ; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&src[i]));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(&dst[i]), _mm_shuffle_epi8(v, mask));
+    }
+    byteSwapScalar<T>(&dst[i], &src[i], (bytes - i) / sizeof(T));
+}
+
+//vpshufb shuffles within each 16 byte half, so the same control serves both halves.
+template<typename T>
+__attribute__((target("avx2"))) void byteSwapAvx2(uint8_t *dst, const uint8_t *src, size_t count)
+{
+    const __m256i mask = _mm256_broadcastsi128_si256(byteSwapMask<T>());
+    size_t bytes = count * sizeof(T);
+    size_t i = 0;
+    for( ; i + 32 <= bytes ; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&src[i]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(&dst[i]), _mm256_shuffle_epi8(v, mask));
+    }
+    byteSwapScalar<T>(&dst[i], &src[i], (bytes - i) / sizeof(T));
+}
+#endif
+
+template<typename T>
+inline ByteSwapFunction selectByteSwap()
+{
+#ifdef HAVE_SIMD_SWAP
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+    {
+        return byteSwapAvx2<T>;
+    }
+    if(__builtin_cpu_supports("ssse3"))
+    {
+        return byteSwapSsse3<T>;
+    }
+#endif
+    return byteSwapScalar<T>;
+}
+
+//A big-endian host keeps values in memory order already, so there is nothing to reverse.
+template<typename T>
+inline void byteSwapBuffer(uint8_t *dst, const uint8_t *src, size_t count)
+{
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    memmove(dst, src, count * sizeof(T));
+#else
+    static const ByteSwapFunction swap = selectByteSwap<T>();
+    swap(dst, src, count);
+#endif
+}
+
+inline void ConvertWordsToBigEndian(uint8_t *bytes, const uint32_t *words, size_t count)
+{
+    byteSwapBuffer<uint32_t>(bytes, reinterpret_cast<const uint8_t *>(words), count);
+}
+
+inline void ConvertWordsFromBigEndian(uint32_t *words, const uint8_t *bytes, size_t count)
+{
+    byteSwapBuffer<uint32_t>(reinterpret_cast<uint8_t *>(words), bytes, count);
+}
+
+inline void ConvertHalfWordsToBigEndian(uint8_t *bytes, const uint16_t *halves, size_t count)
+{
+    byteSwapBuffer<uint16_t>(bytes, reinterpret_cast<const uint8_t *>(halves), count);
+}
+
+inline void ConvertHalfWordsFromBigEndian(uint16_t *halves, const uint8_t *bytes, size_t count)
+{
+    byteSwapBuffer<uint16_t>(reinterpret_cast<uint8_t *>(halves), bytes, count);
+}
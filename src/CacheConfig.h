@@ -3,7 +3,44 @@
 enum CacheType
 {
     DIRECT_MAPPED,
-    TWO_WAY_SET_ASSOC
+    TWO_WAY_SET_ASSOC,
+    //N-way set associative, with N given by CacheConfig::associativity.
+    SET_ASSOC,
+    //A single set holding every block.
+    FULLY_ASSOC
+};
+
+//Which block of a full set is evicted on a miss.
+enum ReplacementType
+{
+    LRU,
+    TREE_PLRU,
+    FIFO,
+    RANDOM,
+    SRRIP
+};
+
+//How a cache below L1 treats the blocks held by the caches above it. Ignored for L1 caches.
+enum InclusionPolicy
+{
+    //Fills go through every level, and each level evicts on its own.
+    NON_INCLUSIVE,
+    //Every block above is also held here. Evicting a block evicts it above too.
+    INCLUSIVE,
+    //A block is held here or above, never both. Blocks evicted above move down here.
+    EXCLUSIVE
+};
+
+//Hardware prefetcher attached to an L1 cache.
+enum PrefetcherType
+{
+    NO_PREFETCH,
+    //The blocks after each missed block.
+    NEXT_LINE_PREFETCH,
+    //Constant strides, learned per load PC.
+    STRIDE_PREFETCH,
+    //Ascending or descending runs of missed blocks.
+    STREAM_PREFETCH
 };
 
 struct CacheConfig
@@ -12,8 +49,43 @@ struct CacheConfig
     uint32_t cacheSize;
     //Cache block size in bytes.
     uint32_t blockSize;
-    //Type of cache - direct-mapped or two-way set-assoc?
+    //Type of cache - direct-mapped, two-way, N-way or fully associative?
     CacheType type;
     //Miss latency in cycles.
     uint32_t missLatency;
+    //Ways per set for SET_ASSOC caches. Ignored by the other types.
+    uint32_t associativity = 0;
+    //Replacement policy for caches with more than one way.
+    ReplacementType replacement = LRU;
+    //Relation to the caches above, for caches below L1.
+    InclusionPolicy inclusion = NON_INCLUSIVE;
+    //Miss status holding registers, for a non-blocking D-cache. 0 keeps the cache blocking,
+    //so a miss stalls the pipeline until its fill completes.
+    uint32_t mshrs = 0;
+    //Prefetcher for an L1 cache, the number of blocks it fetches each time it triggers, and
+    //how far ahead of the access (in blocks, or strides) the first of them is.
+    PrefetcherType prefetcher = NO_PREFETCH;
+    uint32_t prefetchDegree = 1;
+    uint32_t prefetchDistance = 1;
+    //Blocks in a small fully associative victim cache beside an L1 cache, which keeps the blocks
+    //it evicts. 0 means no victim cache.
+    uint32_t victimBlocks = 0;
+    //Cycles a dirty eviction takes to write back. Without a write buffer each miss that evicts a
+    //dirty block waits that long; with one the write drains in the background unless it is full.
+    uint32_t writebackLatency = 0;
+    //Entries in the coalescing write buffer of an L1 cache. 0 means no write buffer.
+    uint32_t writeBufferEntries = 0;
+};
+
+//The LRU caches profiled together by initCacheAnalysis. Every size is a power of two: each cache
+//size from minCacheSize to maxCacheSize is profiled with each block size from minBlockSize to
+//maxBlockSize, direct-mapped, with every associativity up to maxAssociativity, and fully
+//associative.
+struct CacheAnalysisConfig
+{
+    uint32_t minCacheSize = 256;
+    uint32_t maxCacheSize = 65536;
+    uint32_t minBlockSize = 16;
+    uint32_t maxBlockSize = 64;
+    uint32_t maxAssociativity = 8;
 };
@@ -1,4 +1,5 @@
 #include "CacheConfig.h"
+#include "BranchConfig.h"
 
 struct PipeState
 {
@@ -19,12 +20,112 @@ struct SimulationStats
     uint32_t dcMisses;
 };
 
+//Counts for one shared cache level below the L1 caches. Hits and misses are block requests
+//from the levels above; writebacks are dirty blocks this level sent further down.
+struct CacheLevelStats
+{
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t writebacks;
+};
+
+//Counts for a non-blocking D-cache. Merges are accesses to a block already being fetched.
+//Full stalls are misses that had to wait for a free MSHR. busyCycles adds up how long each MSHR
+//was held and missCycles counts cycles with at least one held, so their ratio is the average
+//memory-level parallelism while missing.
+struct MshrStats
+{
+    uint32_t merges;
+    uint32_t fullStalls;
+    uint64_t busyCycles;
+    uint64_t missCycles;
+};
+
+//Counts for an L1 cache prefetcher. Useful prefetches were used after they arrived, late ones
+//while still in flight. Useless ones were evicted unused. Pollution counts demand misses on
+//blocks that a prefetch had evicted.
+struct PrefetchStats
+{
+    uint32_t issued;
+    uint32_t useful;
+    uint32_t late;
+    uint32_t useless;
+    uint32_t pollution;
+};
+
+//Counts for an L1 victim cache. Hits are misses served by a swap with the victim cache, and
+//savedCycles adds up the miss latency those swaps did not pay.
+struct VictimCacheStats
+{
+    uint32_t hits;
+    uint32_t evictions;
+    uint64_t savedCycles;
+};
+
+//Counts for the writebacks of an L1 cache. Buffered writes went to the write buffer and merged
+//ones into an entry still waiting there. Full stalls are misses that waited for a free entry.
+//stallCycles is the time misses spent on writebacks, with or without a buffer.
+struct WriteBufferStats
+{
+    uint32_t buffered;
+    uint32_t merged;
+    uint32_t fullStalls;
+    uint64_t stallCycles;
+};
+
+//Counts for the branch predictor. Branches are conditional branches, correct ones were predicted
+//the right way whether or not decode needed the guess. Speculated counts branches and jr that left
+//decode on a prediction instead of stalling for their operands, and mispredicts those that were
+//wrong and flushed fetch. savedCycles is the decode stalls the right guesses avoided.
+struct BranchStats
+{
+    uint32_t branches;
+    uint32_t correct;
+    uint32_t speculated;
+    uint32_t mispredicts;
+    uint64_t savedCycles;
+};
+
 //Implemented in UtilityFunctions.o
 int dumpPipeState(PipeState & state);
 int printSimStats(SimulationStats & stats);
 
 //You must implement the following functions.
 int initSimulator(CacheConfig & icConfig, CacheConfig & dcConfig, MemoryStore *mainMem);
+//As above, with numLevels shared caches between the L1 caches and main memory, L2 first.
+int initSimulator(CacheConfig & icConfig, CacheConfig & dcConfig, CacheConfig *lowerConfigs,
+                  uint32_t numLevels, MemoryStore *mainMem);
+//Optional, after initSimulator: predict branches instead of stalling decode for their operands.
+int initBranchPredictor(BranchPredictorConfig & bpConfig);
+//Optional, after initSimulator: also profile the I- and D-streams against every LRU cache in
+//analysisConfig in the same run, writing their hits and misses to cache_curve.out.
+int initCacheAnalysis(CacheAnalysisConfig & analysisConfig);
+//Optional, after initSimulator: record every fetch and data access the caches see to a trace in
+//fileName (see TraceFile.h), finished by finalizeSimulator.
+int initTrace(const char *fileName);
+//Optional, between initSimulator and finalizeSimulator: save the whole simulation to fileName,
+//from the registers, pipeline latches and statistics to the contents of the caches and memory.
+//Only L1 caches without MSHRs, prefetchers, victim caches or write buffers, and no branch
+//predictor or cache analysis, can be saved. Returns 0, or a negative error after saying why.
+int saveCheckpoint(const char *fileName);
+//Instead of initSimulator: carry on from a checkpoint, writing its memory into mainMem. Given
+//cache configs, the caches are built from those instead; one that matches the checkpoint's takes
+//its contents back, and one that does not starts empty, with the checkpoint's dirty blocks
+//written back to memory, and counts its hits and misses from the checkpoint on. A checkpoint
+//from ./sim --fast-forward holds only the PC, registers and memory: it needs the configs, and
+//starts the pipeline empty with its statistics at zero.
+int initSimulatorFromCheckpoint(const char *fileName, MemoryStore *mainMem);
+int initSimulatorFromCheckpoint(const char *fileName, CacheConfig & icConfig, CacheConfig & dcConfig,
+                                MemoryStore *mainMem);
+//Optional, straight after initSimulatorFromCheckpoint: make every access of a trace (see
+//TraceFile.h) again in the L1 caches, then zero their counts, so a fast-forwarded run starts
+//with caches as warm as if the pipeline had run the whole way. Only caches that can be
+//checkpointed can be warmed.
+int warmCaches(const char *fileName);
 int runCycles(uint32_t cycles);
 int runTillHalt();
 int finalizeSimulator();
+
+//For drivers that take cache configs on the command line: sets config's type and associativity
+//from a type named direct, 2way, Nway (N ways) or full. Returns false for any other name.
+bool parseCacheType(const char *name, CacheConfig & config);
@@ -0,0 +1,176 @@
+#include <iostream>
+#include <string.h>
+#include <errno.h>
+
+//A memory store kept in this tree, as one flat MEMORY_SIZE byte array. It accepts and refuses
+//exactly the accesses the prebuilt store does, with the same messages, so either can back a
+//simulator. Code that holds a FlatMemoryStore * rather than a MemoryStore * binds to it
+//statically: the class is final, so the virtual calls below resolve at compile time, and a
+//constant size folds the switch away, leaving the inline read/write templates.
+class FlatMemoryStore final : public BlockMemoryStore
+{
+    private:
+        uint8_t bytes[MEMORY_SIZE];
+
+        //The prebuilt store refuses any access reaching the last byte of memory.
+        static bool inRange(uint32_t address, uint32_t size)
+        {
+            return address < MEMORY_SIZE - size;
+        }
+
+        __attribute__((noinline, cold)) static int outOfRange(uint32_t address)
+        {
+            std::cerr << "Address 0x" << std::hex << address << " is out of range" << std::endl;
+            return -EINVAL;
+        }
+
+        __attribute__((noinline, cold)) static int invalidSize()
+        {
+            std::cerr << "Invalid size passed, cannot read/write memory" << std::endl;
+            return -EINVAL;
+        }
+
+    public:
+        FlatMemoryStore()
+        {
+            memset(bytes, 0, sizeof(bytes));
+        }
+
+        //Big-endian accessors for one MemEntrySize. Alignment is not checked, as in the
+        //prebuilt store.
+        template<MemEntrySize size>
+        int read(uint32_t address, uint32_t & value)
+        {
+            if(__builtin_expect(!inRange(address, size), 0))
+            {
+                return outOfRange(address);
+            }
+
+            uint32_t result = 0;
+            for(uint32_t i = 0 ; i < size ; i++)
+            {
+                result = (result << 8) | bytes[address + i];
+            }
+            value = result;
+            return 0;
+        }
+
+        template<MemEntrySize size>
+        int write(uint32_t address, uint32_t value)
+        {
+            if(__builtin_expect(!inRange(address, size), 0))
+            {
+                return outOfRange(address);
+            }
+
+            for(uint32_t i = 0 ; i < size ; i++)
+            {
+                bytes[address + i] = value >> (8 * (size - 1 - i));
+            }
+            return 0;
+        }
+
+        int getMemValue(uint32_t address, uint32_t & value, MemEntrySize size) override
+        {
+            switch(size)
+            {
+                case BYTE_SIZE:
+                    return read<BYTE_SIZE>(address, value);
+                case HALF_SIZE:
+                    return read<HALF_SIZE>(address, value);
+                case WORD_SIZE:
+                    return read<WORD_SIZE>(address, value);
+                default:
+                    return invalidSize();
+            }
+        }
+
+        int setMemValue(uint32_t address, uint32_t value, MemEntrySize size) override
+        {
+            switch(size)
+            {
+                case BYTE_SIZE:
+                    return write<BYTE_SIZE>(address, value);
+                case HALF_SIZE:
+                    return write<HALF_SIZE>(address, value);
+                case WORD_SIZE:
+                    return write<WORD_SIZE>(address, value);
+                default:
+                    return invalidSize();
+            }
+        }
+
+        //A range reaching the end of memory goes byte by byte, reporting each refused byte
+        //once, like the word-at-a-time fallback in MemoryStore.h.
+        int getMemBlock(uint32_t address, uint8_t *data, uint32_t size) override
+        {
+            if(__builtin_expect(size <= MEMORY_SIZE && inRange(address, size), 1))
+            {
+                memcpy(data, &bytes[address], size);
+                return 0;
+            }
+
+            int ret = 0;
+            for(uint32_t i = 0 ; i < size ; i++)
+            {
+                uint32_t value = 0;
+                if(int err = read<BYTE_SIZE>(address + i, value))
+                {
+                    ret = err;
+                }
+                data[i] = value;
+            }
+            return ret;
+        }
+
+        int setMemBlock(uint32_t address, const uint8_t *data, uint32_t size) override
+        {
+            if(__builtin_expect(size <= MEMORY_SIZE && inRange(address, size), 1))
+            {
+                memcpy(&bytes[address], data, size);
+                return 0;
+            }
+
+            int ret = 0;
+            for(uint32_t i = 0 ; i < size ; i++)
+            {
+                if(int err = write<BYTE_SIZE>(address + i, data[i]))
+                {
+                    ret = err;
+                }
+            }
+            return ret;
+        }
+
+        //The prebuilt store, holding a copy of this one. The caller deletes it. It goes through
+        //the word-at-a-time fallback, so the bytes are converted to words in bulk and everything
+        //but the last byte, which the prebuilt store never accepts, is copied.
+        MemoryStore *copyToMemoryStore()
+        {
+            MemoryStore *copy = createMemoryStore();
+            ::setMemBlock(copy, 0, bytes, MEMORY_SIZE - 1);
+            return copy;
+        }
+
+        bool holds(uint32_t address, uint32_t size) override
+        {
+            return inRange(address, size);
+        }
+
+        //Printed by the prebuilt store, so the output is the same.
+        int printMemory(uint32_t startAddress, uint32_t endAddress) override
+        {
+            MemoryStore *copy = copyToMemoryStore();
+            int ret = copy->printMemory(startAddress, endAddress);
+            delete copy;
+            return ret;
+        }
+};
+
+//The prebuilt dumpMemoryState only takes its own store, so this dumps a copy.
+inline void dumpMemoryState(FlatMemoryStore *mem)
+{
+    MemoryStore *copy = mem->copyToMemoryStore();
+    dumpMemoryState(copy);
+    delete copy;
+}
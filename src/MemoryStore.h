@@ -1,4 +1,9 @@
 #include <inttypes.h>
+#include <errno.h>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include "ByteSwap.h"
 
 //The memory is 64 KB large.
 #define MEMORY_SIZE 0x10000
@@ -23,6 +28,215 @@ class MemoryStore
         virtual ~MemoryStore() {}
 };
 
+//A memory store that can also move a whole run of bytes (e.g. a cache block) in one call.
+//Bytes are in memory order, so data[0] is the byte at address. This is a separate interface
+//rather than new virtuals on MemoryStore because the layout of MemoryStore is fixed by the
+//prebuilt implementation in UtilityFunctions.o.
+class BlockMemoryStore : public MemoryStore
+{
+    public:
+        virtual int getMemBlock(uint32_t address, uint8_t *data, uint32_t size) = 0;
+        virtual int setMemBlock(uint32_t address, const uint8_t *data, uint32_t size) = 0;
+        //Whether an access of size bytes at address is in range, so it would not be refused.
+        virtual bool holds(uint32_t address, uint32_t size) = 0;
+};
+
+//Whether the word-at-a-time fallback below can use a word access at addr with left bytes to go.
+//The prebuilt store rejects word accesses that end on the last byte of memory, so those (and
+//anything out of range) go byte by byte, which reports each bad address exactly once. addr is
+//taken 64 bits wide, so a run off the top of the address space does not wrap back into range.
+inline bool wordAccessible(uint64_t addr, uint32_t left)
+{
+    return addr % WORD_SIZE == 0 && left >= WORD_SIZE && addr < MEMORY_SIZE && MEMORY_SIZE - addr > WORD_SIZE;
+}
+
+//Refuses a byte of the fallback below that lies past the end of memory. The prebuilt store cannot
+//be asked about one: it crashes when the address plus the size wraps to 0, so the byte is
+//reported here, in the store's words.
+inline int refuseByte(uint64_t addr)
+{
+    std::cout << "Address 0x" << std::hex << (uint32_t) addr << " is out of range" << std::dec << std::endl;
+    return -EINVAL;
+}
+
+//Whether mem takes an access of size bytes at address. A store that is not a BlockMemoryStore is
+//taken to be the prebuilt one, which refuses any access reaching its last byte.
+inline bool memoryHolds(MemoryStore *mem, uint32_t address, uint32_t size)
+{
+    if(BlockMemoryStore *blockMem = dynamic_cast<BlockMemoryStore *>(mem))
+    {
+        return blockMem->holds(address, size);
+    }
+    return address < MEMORY_SIZE && size < MEMORY_SIZE - address;
+}
+
+//How many words the fallback below gathers before converting them to or from bytes in one go.
+#define FALLBACK_RUN_WORDS 64
+
+//Reads size bytes starting at address into data. Uses a single getMemBlock call when mem is a
+//BlockMemoryStore, otherwise falls back to one getMemValue call per aligned word, with each run
+//of words turned into bytes by one ConvertWordsToBigEndian call.
+inline int getMemBlock(MemoryStore *mem, uint32_t address, uint8_t *data, uint32_t size)
+{
+    if(BlockMemoryStore *blockMem = dynamic_cast<BlockMemoryStore *>(mem))
+    {
+        return blockMem->getMemBlock(address, data, size);
+    }
+
+    int ret = 0;
+    uint32_t i = 0;
+    uint32_t words[FALLBACK_RUN_WORDS];
+    while(i < size)
+    {
+        uint32_t run = 0;
+        bool refused = false;
+        while(run < FALLBACK_RUN_WORDS && wordAccessible((uint64_t) address + i + run * WORD_SIZE, size - i - run * WORD_SIZE))
+        {
+            if(mem->getMemValue(address + i + run * WORD_SIZE, words[run], WORD_SIZE) != 0)
+            {
+                refused = true;
+                break;
+            }
+            run++;
+        }
+        ConvertWordsToBigEndian(&data[i], words, run);
+        i += run * WORD_SIZE;
+        if(run > 0 && !refused)
+        {
+            continue;
+        }
+
+        //Unaligned head/tail, or a word the store refused: go byte by byte. A byte past the end
+        //of memory reads as 0.
+        uint32_t value = 0;
+        if((uint64_t) address + i >= MEMORY_SIZE)
+        {
+            ret = refuseByte((uint64_t) address + i);
+        }
+        else if(int err = mem->getMemValue(address + i, value, BYTE_SIZE))
+        {
+            ret = err;
+            value = 0;
+        }
+        data[i] = value;
+        i++;
+    }
+    return ret;
+}
+
+//Writes size bytes from data starting at address. See getMemBlock.
+inline int setMemBlock(MemoryStore *mem, uint32_t address, const uint8_t *data, uint32_t size)
+{
+    if(BlockMemoryStore *blockMem = dynamic_cast<BlockMemoryStore *>(mem))
+    {
+        return blockMem->setMemBlock(address, data, size);
+    }
+
+    int ret = 0;
+    uint32_t i = 0;
+    uint32_t words[FALLBACK_RUN_WORDS];
+    while(i < size)
+    {
+        uint32_t run = 0;
+        while(run < FALLBACK_RUN_WORDS && wordAccessible((uint64_t) address + i + run * WORD_SIZE, size - i - run * WORD_SIZE))
+        {
+            run++;
+        }
+        ConvertWordsFromBigEndian(words, &data[i], run);
+
+        uint32_t done = 0;
+        while(done < run && mem->setMemValue(address + i + done * WORD_SIZE, words[done], WORD_SIZE) == 0)
+        {
+            done++;
+        }
+        i += done * WORD_SIZE;
+        if(done > 0 && done == run)
+        {
+            continue;
+        }
+
+        //Unaligned head/tail, or a word the store refused: go byte by byte. A byte past the end
+        //of memory is dropped.
+        if((uint64_t) address + i >= MEMORY_SIZE)
+        {
+            ret = refuseByte((uint64_t) address + i);
+        }
+        else if(int err = mem->setMemValue(address + i, data[i], BYTE_SIZE))
+        {
+            ret = err;
+        }
+        i++;
+    }
+    return ret;
+}
+
+//Prints [startAddress, endAddress) of mem in the prebuilt store's format: lines of perLine
+//entries of width bytes each, starting with their address. Works on any store.
+inline int printMemoryRange(MemoryStore *mem, uint32_t startAddress, uint32_t endAddress, uint32_t width,
+                            uint32_t perLine, std::ostream & out)
+{
+    if(startAddress > endAddress)
+    {
+        std::cerr << "Address range 0x" << std::hex << startAddress << "-0x" << endAddress
+                  << " is out of range" << std::endl;
+        return -EINVAL;
+    }
+    if(width != BYTE_SIZE && width != HALF_SIZE && width != WORD_SIZE)
+    {
+        std::cerr << "Invalid print size passed, cannot print memory" << std::endl;
+        return -EINVAL;
+    }
+
+    uint32_t addr = startAddress;
+    uint32_t lineAddr = startAddress;
+    while(addr < endAddress)
+    {
+        out << "0x" << std::hex << std::setfill('0') << std::setw(8) << lineAddr << ": ";
+        for(uint32_t i = 0 ; i < perLine ; i++)
+        {
+            if(addr >= endAddress)
+            {
+                out << std::endl;
+                return 0;
+            }
+
+            out << "0x";
+            for(uint32_t j = 0 ; j < width ; j++, addr++)
+            {
+                uint32_t byte = 0;
+                mem->getMemValue(addr, byte, BYTE_SIZE);
+                out << std::hex << std::setfill('0') << std::setw(2) << byte;
+            }
+            out << " ";
+        }
+        out << std::endl;
+        lineAddr += width * perLine;
+    }
+    return 0;
+}
+
+//Writes what the prebuilt dumpMemoryState puts in mem_state.out to out: the range named in
+//print_mem_range (0 to 0x1f4 by default) between its banners.
+inline void printMemoryState(MemoryStore *mem, std::ostream & out)
+{
+    uint32_t startAddress = 0;
+    uint32_t endAddress = 0x1f4;
+
+    std::ifstream range("print_mem_range");
+    if(range)
+    {
+        range >> std::hex >> startAddress >> std::hex >> endAddress;
+    }
+
+    out << "---------------------" << std::endl;
+    out << "Begin Memory State" << std::endl;
+    out << "---------------------" << std::endl;
+    printMemoryRange(mem, startAddress, endAddress, WORD_SIZE, 5, out);
+    out << "---------------------" << std::endl;
+    out << "End Memory State" << std::endl;
+    out << "---------------------" << std::endl;
+}
+
 //Creates a memory store.
 extern MemoryStore *createMemoryStore();
 
@@ -0,0 +1,228 @@
+#include <iostream>
+#include <vector>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//Loads a program into memory. The file is mapped rather than read, and each piece of it goes
+//into memory in one setMemBlock call. Two formats are understood:
+// - a raw image, as objcopy -O binary writes it: big-endian words placed from address 0. A
+//   trailing partial word is ignored, as it always has been.
+// - an ELF32 big-endian file. A linked executable has each PT_LOAD segment placed at its
+//   virtual address, so .text and .data both land where they were linked, with the rest of
+//   each segment zeroed; its entry point has to be 0, where the simulators start. An object
+//   straight from the assembler has no load addresses, and its data is not relocated, so only
+//   its .text is placed, at 0 - exactly what objcopy -j .text -O binary used to produce.
+
+#define ELF_HEADER_SIZE 52
+#define ELF_PHDR_SIZE 32
+#define ELF_SHDR_SIZE 40
+#define ELF_CLASS32 1
+#define ELF_DATA2MSB 2
+#define ELF_TYPE_REL 1
+#define ELF_PT_LOAD 1
+#define ELF_SHT_NOBITS 8
+#define ELF_SHF_ALLOC 0x2
+//The one section an unlinked object has placed, with its terminating NUL.
+#define ELF_TEXT_NAME ".text"
+#define ELF_TEXT_NAME_SIZE sizeof(ELF_TEXT_NAME)
+
+inline uint16_t readBigEndianHalf(const uint8_t *bytes)
+{
+    return (bytes[0] << 8) | bytes[1];
+}
+
+inline uint32_t readBigEndianWord(const uint8_t *bytes)
+{
+    return ((uint32_t) bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+}
+
+//Whether [offset, offset + size) lies inside a file of fileSize bytes. Sizes are taken 64 bits
+//wide, so a table's entry count times its entry size cannot overflow on the way in.
+inline bool inFile(uint64_t offset, uint64_t size, size_t fileSize)
+{
+    return offset <= fileSize && size <= fileSize - offset;
+}
+
+//Places fileBytes bytes of data at address, then zeroes the next zeroBytes.
+inline int loadSegment(MemoryStore *mem, uint32_t address, const uint8_t *data, uint32_t fileBytes, uint32_t zeroBytes)
+{
+    if(fileBytes && setMemBlock(mem, address, data, fileBytes))
+    {
+        return -EINVAL;
+    }
+    if(zeroBytes)
+    {
+        std::vector<uint8_t> zeros(zeroBytes, 0);
+        if(setMemBlock(mem, address + fileBytes, zeros.data(), zeroBytes))
+        {
+            return -EINVAL;
+        }
+    }
+    return 0;
+}
+
+inline int loadElf(const uint8_t *image, size_t size, MemoryStore *mem)
+{
+    if(size < ELF_HEADER_SIZE || image[4] != ELF_CLASS32 || image[5] != ELF_DATA2MSB)
+    {
+        std::cout << "Only 32-bit big-endian ELF files can be loaded" << std::endl;
+        return -EINVAL;
+    }
+
+    uint16_t type = readBigEndianHalf(&image[16]);
+    uint32_t entry = readBigEndianWord(&image[24]);
+    uint32_t phoff = readBigEndianWord(&image[28]);
+    uint32_t shoff = readBigEndianWord(&image[32]);
+    uint16_t phentsize = readBigEndianHalf(&image[42]);
+    uint16_t phnum = readBigEndianHalf(&image[44]);
+    uint16_t shentsize = readBigEndianHalf(&image[46]);
+    uint16_t shnum = readBigEndianHalf(&image[48]);
+    uint16_t shstrndx = readBigEndianHalf(&image[50]);
+
+    if(phnum > 0)
+    {
+        //The simulators start every program at pc 0, so one linked to start anywhere else would
+        //run from the wrong instruction.
+        if(entry != 0)
+        {
+            std::cout << "ELF entry point 0x" << std::hex << entry << std::dec << " is not 0, where the simulators start"
+                      << std::endl;
+            return -EINVAL;
+        }
+
+        if(phentsize < ELF_PHDR_SIZE || !inFile(phoff, (uint64_t) phnum * phentsize, size))
+        {
+            std::cout << "Truncated ELF file" << std::endl;
+            return -EINVAL;
+        }
+
+        for(uint32_t i = 0 ; i < phnum ; i++)
+        {
+            const uint8_t *phdr = &image[phoff + (uint64_t) i * phentsize];
+            if(readBigEndianWord(&phdr[0]) != ELF_PT_LOAD)
+            {
+                continue;
+            }
+
+            uint32_t offset = readBigEndianWord(&phdr[4]);
+            uint32_t vaddr = readBigEndianWord(&phdr[8]);
+            uint32_t filesz = readBigEndianWord(&phdr[16]);
+            uint32_t memsz = readBigEndianWord(&phdr[20]);
+            if(!inFile(offset, filesz, size) || memsz < filesz)
+            {
+                std::cout << "Truncated ELF file" << std::endl;
+                return -EINVAL;
+            }
+
+            if(loadSegment(mem, vaddr, &image[offset], filesz, memsz - filesz))
+            {
+                std::cout << "Could not set memory value!" << std::endl;
+                return -EINVAL;
+            }
+        }
+        return 0;
+    }
+
+    //No program headers: go by the sections instead.
+    if(shentsize < ELF_SHDR_SIZE || !inFile(shoff, (uint64_t) shnum * shentsize, size) || shstrndx >= shnum)
+    {
+        std::cout << "Truncated ELF file" << std::endl;
+        return -EINVAL;
+    }
+
+    const uint8_t *strtab = &image[shoff + (uint64_t) shstrndx * shentsize];
+    uint32_t namesOffset = readBigEndianWord(&strtab[16]);
+    uint32_t namesSize = readBigEndianWord(&strtab[20]);
+    if(!inFile(namesOffset, namesSize, size))
+    {
+        std::cout << "Truncated ELF file" << std::endl;
+        return -EINVAL;
+    }
+
+    for(uint32_t i = 0 ; i < shnum ; i++)
+    {
+        const uint8_t *shdr = &image[shoff + (uint64_t) i * shentsize];
+        uint32_t name = readBigEndianWord(&shdr[0]);
+        uint32_t sectionType = readBigEndianWord(&shdr[4]);
+        uint32_t flags = readBigEndianWord(&shdr[8]);
+        uint32_t addr = readBigEndianWord(&shdr[12]);
+        uint32_t offset = readBigEndianWord(&shdr[16]);
+        uint32_t sectionSize = readBigEndianWord(&shdr[20]);
+
+        if(!(flags & ELF_SHF_ALLOC) || name >= namesSize)
+        {
+            continue;
+        }
+        const char *sectionName = reinterpret_cast<const char *>(&image[namesOffset + name]);
+        //The whole name, NUL and all, has to fit in the table, so a truncated ".tex" is not it.
+        if(type == ELF_TYPE_REL &&
+           (namesSize - name < ELF_TEXT_NAME_SIZE || memcmp(sectionName, ELF_TEXT_NAME, ELF_TEXT_NAME_SIZE) != 0))
+        {
+            continue;
+        }
+
+        bool noBits = sectionType == ELF_SHT_NOBITS;
+        if(!noBits && !inFile(offset, sectionSize, size))
+        {
+            std::cout << "Truncated ELF file" << std::endl;
+            return -EINVAL;
+        }
+
+        if(loadSegment(mem, addr, &image[offset], noBits ? 0 : sectionSize, noBits ? sectionSize : 0))
+        {
+            std::cout << "Could not set memory value!" << std::endl;
+            return -EINVAL;
+        }
+    }
+    return 0;
+}
+
+//Loads fileName into mem, as a raw image or an ELF file. Returns 0, or -EINVAL after saying why.
+inline int loadProgram(const char *fileName, MemoryStore *mem)
+{
+    int fd = mem ? open(fileName, O_RDONLY) : -1;
+    struct stat info;
+    if(fd < 0 || fstat(fd, &info) != 0)
+    {
+        if(fd >= 0)
+        {
+            close(fd);
+        }
+        std::cout << "Invalid file stream or memory image passed, could not initialise memory values" << std::endl;
+        return -EINVAL;
+    }
+
+    size_t size = info.st_size;
+    if(size == 0)
+    {
+        close(fd);
+        return 0;
+    }
+
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED)
+    {
+        std::cout << "Invalid file stream or memory image passed, could not initialise memory values" << std::endl;
+        return -EINVAL;
+    }
+
+    const uint8_t *image = static_cast<const uint8_t *>(mapping);
+    int ret = 0;
+    if(size >= 4 && memcmp(image, "\177ELF", 4) == 0)
+    {
+        ret = loadElf(image, size, mem);
+    }
+    else if(loadSegment(mem, 0, image, size & ~3u, 0))
+    {
+        std::cout << "Could not set memory value!" << std::endl;
+        ret = -EINVAL;
+    }
+
+    munmap(mapping, size);
+    return ret;
+}
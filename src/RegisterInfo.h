@@ -1,3 +1,6 @@
+#include <iostream>
+#include <iomanip>
+
 #define V_REG_SIZE 2
 #define A_REG_SIZE 4
 #define T_REG_SIZE 10
@@ -30,3 +33,44 @@ struct RegisterInfo
 };
 
 extern void dumpRegisterState(RegisterInfo & reg);
+
+//Writes one group of registers as the prebuilt dump does, e.g. "$t0 = 0x0000006c".
+inline void printRegisterGroup(std::ostream & out, const char *prefix, const uint32_t *values, int count)
+{
+    for(int i = 0 ; i < count ; i++)
+    {
+        out << "$" << prefix;
+        if(count > 1)
+        {
+            out << std::dec << i;
+        }
+        out << " = 0x" << std::hex << std::setfill('0') << std::setw(8) << values[i] << std::endl;
+    }
+}
+
+//Writes what dumpRegisterState puts in reg_state.out to out.
+inline void printRegisterState(RegisterInfo & reg, std::ostream & out)
+{
+    out << "---------------------" << std::endl;
+    out << "Begin Register Values" << std::endl;
+    out << "---------------------" << std::endl;
+    printRegisterGroup(out, "at", &reg.at, 1);
+    out << std::endl;
+    printRegisterGroup(out, "v", reg.v, V_REG_SIZE);
+    out << std::endl;
+    printRegisterGroup(out, "a", reg.a, A_REG_SIZE);
+    out << std::endl;
+    printRegisterGroup(out, "t", reg.t, T_REG_SIZE);
+    out << std::endl;
+    printRegisterGroup(out, "s", reg.s, S_REG_SIZE);
+    out << std::endl;
+    printRegisterGroup(out, "k", reg.k, K_REG_SIZE);
+    out << std::endl;
+    printRegisterGroup(out, "gp", &reg.gp, 1);
+    printRegisterGroup(out, "sp", &reg.sp, 1);
+    printRegisterGroup(out, "fp", &reg.fp, 1);
+    printRegisterGroup(out, "ra", &reg.ra, 1);
+    out << "---------------------" << std::endl;
+    out << "End Register Values" << std::endl;
+    out << "---------------------" << std::endl;
+}
@@ -0,0 +1,282 @@
+#include <vector>
+#include <array>
+#include <random>
+#include <algorithm>
+#include <unordered_map>
+#include <float.h>
+
+//Sampled simulation in the style of SimPoint. A run is cut into intervals of a fixed number of
+//instructions, and each interval summed up as a basic-block vector: how many of its instructions
+//ran in each block of code. Intervals whose vectors are alike run alike, so clustering them and
+//simulating a few intervals of each cluster in detail gives the whole run's cycles, scaled up by
+//how many instructions each cluster covers.
+//
+//Vectors are normalised and randomly projected down to SIMPOINT_DIMENSIONS, as SimPoint does, so
+//they take the same room however much code a program has. A block here is a run of instructions
+//entered anywhere but from the one before it, so a block ends at every taken branch or jump.
+//
+//./sim --simpoints writes a plan, a text file of lines of these forms:
+//  interval <instructions per interval>
+//  instructions <instructions in the whole run>
+//  cluster <cluster> <intervals in it> <instructions in it>
+//  sample <cluster> <interval> <instructions in it> <checkpoint file> <trace file>
+//Each sample's checkpoint is where its interval starts, and its trace the accesses of the
+//interval before, to warm the caches with. The clusters come before their samples.
+
+#define SIMPOINT_DIMENSIONS 15
+//k-means runs from this many starting points, keeping the tightest clustering.
+#define SIMPOINT_RESTARTS 5
+#define SIMPOINT_ITERATIONS 100
+#define SIMPOINT_SEED 1
+
+typedef std::array<double, SIMPOINT_DIMENSIONS> SimPointVector;
+
+//Builds the projected basic-block vector of each interval as a run goes.
+class BasicBlockProfile
+{
+    private:
+        uint64_t interval;
+        //Instructions run when the current interval started.
+        uint64_t intervalStart;
+        //Each block is numbered the first time it runs; its row of the projection is drawn then.
+        std::unordered_map<uint32_t, uint32_t> blockIds;
+        std::vector<SimPointVector> projection;
+        //Instructions run in each block this interval, and the blocks with any.
+        std::vector<uint64_t> counts;
+        std::vector<uint32_t> touched;
+        uint32_t block;
+        //Starts unaligned, so that the first instruction opens a block wherever it is.
+        uint32_t lastPC;
+        std::mt19937 random;
+        std::vector<SimPointVector> points;
+        std::vector<uint64_t> starts;
+
+        void closeInterval(uint64_t instructionsRun)
+        {
+            SimPointVector point{};
+            double total = instructionsRun - intervalStart;
+            for(uint32_t id : touched)
+            {
+                double share = counts[id] / total;
+                for(uint32_t d = 0 ; d < SIMPOINT_DIMENSIONS ; d++)
+                {
+                    point[d] += share * projection[id][d];
+                }
+                counts[id] = 0;
+            }
+            touched.clear();
+            points.push_back(point);
+            starts.push_back(intervalStart);
+            intervalStart = instructionsRun;
+        }
+
+    public:
+        BasicBlockProfile(uint64_t intervalLength) : interval(intervalLength), intervalStart(0),
+            block(0), lastPC(UINT32_MAX), random(SIMPOINT_SEED) {}
+
+        //One step of the run: the instructions that ran starting at pc, leaving instructionsRun in
+        //all. An interval closes at the first step to reach its length, so a branch and its delay
+        //slot always fall in the same one.
+        void count(uint32_t pc, uint32_t instructions, uint64_t instructionsRun)
+        {
+            if(pc != lastPC + 4)
+            {
+                auto found = blockIds.emplace(pc, blockIds.size());
+                if(found.second)
+                {
+                    std::uniform_real_distribution<double> entry(-1.0, 1.0);
+                    SimPointVector row;
+                    for(double & value : row)
+                    {
+                        value = entry(random);
+                    }
+                    projection.push_back(row);
+                    counts.push_back(0);
+                }
+                block = found.first->second;
+            }
+            lastPC = pc;
+
+            if(!counts[block])
+            {
+                touched.push_back(block);
+            }
+            counts[block] += instructions;
+            if(instructionsRun - intervalStart >= interval)
+            {
+                closeInterval(instructionsRun);
+            }
+        }
+
+        //Closes the last interval, however short, once the run is over.
+        void finish(uint64_t instructionsRun)
+        {
+            if(instructionsRun > intervalStart)
+            {
+                closeInterval(instructionsRun);
+            }
+        }
+
+        const std::vector<SimPointVector> & getPoints()
+        {
+            return points;
+        }
+
+        //Instructions run before each interval.
+        const std::vector<uint64_t> & getStarts()
+        {
+            return starts;
+        }
+};
+
+struct SimPointCluster
+{
+    std::vector<uint32_t> intervals;
+    //The intervals to simulate, the one nearest the centre first.
+    std::vector<uint32_t> samples;
+};
+
+inline double simPointDistance(const SimPointVector & a, const SimPointVector & b)
+{
+    double sum = 0;
+    for(uint32_t d = 0 ; d < SIMPOINT_DIMENSIONS ; d++)
+    {
+        sum += (a[d] - b[d]) * (a[d] - b[d]);
+    }
+    return sum;
+}
+
+//Lloyd's k-means from a k-means++ start. Fills in each point's cluster and returns the sum of
+//squared distances to the centres.
+inline double simPointKMeans(const std::vector<SimPointVector> & points, uint32_t k, std::mt19937 & random,
+                             std::vector<uint32_t> & assignment, std::vector<SimPointVector> & centres)
+{
+    centres.assign(1, points[random() % points.size()]);
+    std::vector<double> nearest(points.size(), DBL_MAX);
+    while(centres.size() < k)
+    {
+        double total = 0;
+        for(uint32_t i = 0 ; i < points.size() ; i++)
+        {
+            nearest[i] = std::min(nearest[i], simPointDistance(points[i], centres.back()));
+            total += nearest[i];
+        }
+        double pick = std::uniform_real_distribution<double>(0, total)(random);
+        uint32_t next = 0;
+        while(next + 1 < points.size() && (pick -= nearest[next]) > 0)
+        {
+            next++;
+        }
+        centres.push_back(points[next]);
+    }
+
+    assignment.assign(points.size(), 0);
+    double error = 0;
+    for(uint32_t iteration = 0 ; iteration < SIMPOINT_ITERATIONS ; iteration++)
+    {
+        bool moved = false;
+        error = 0;
+        for(uint32_t i = 0 ; i < points.size() ; i++)
+        {
+            double best = DBL_MAX;
+            uint32_t bestCluster = 0;
+            for(uint32_t c = 0 ; c < k ; c++)
+            {
+                double distance = simPointDistance(points[i], centres[c]);
+                if(distance < best)
+                {
+                    best = distance;
+                    bestCluster = c;
+                }
+            }
+            moved |= iteration == 0 || assignment[i] != bestCluster;
+            assignment[i] = bestCluster;
+            error += best;
+        }
+        if(!moved)
+        {
+            break;
+        }
+
+        //A cluster left empty keeps its centre.
+        std::vector<SimPointVector> sums(k, SimPointVector{});
+        std::vector<uint32_t> sizes(k, 0);
+        for(uint32_t i = 0 ; i < points.size() ; i++)
+        {
+            sizes[assignment[i]]++;
+            for(uint32_t d = 0 ; d < SIMPOINT_DIMENSIONS ; d++)
+            {
+                sums[assignment[i]][d] += points[i][d];
+            }
+        }
+        for(uint32_t c = 0 ; c < k ; c++)
+        {
+            for(uint32_t d = 0 ; sizes[c] && d < SIMPOINT_DIMENSIONS ; d++)
+            {
+                centres[c][d] = sums[c][d] / sizes[c];
+            }
+        }
+    }
+    return error;
+}
+
+//Clusters the intervals into at most k groups and picks up to samplesPerCluster of each to
+//simulate: the interval nearest the centre, which is SimPoint's choice, and then others drawn at
+//random, so that the spread of a cluster can be estimated. Empty clusters are left out.
+inline std::vector<SimPointCluster> chooseSimPoints(const std::vector<SimPointVector> & points, uint32_t k,
+                                                    uint32_t samplesPerCluster)
+{
+    std::vector<SimPointCluster> clusters;
+    k = std::min<uint32_t>(k, points.size());
+    if(k == 0)
+    {
+        return clusters;
+    }
+
+    std::mt19937 random(SIMPOINT_SEED);
+    std::vector<uint32_t> assignment, bestAssignment;
+    std::vector<SimPointVector> centres, bestCentres;
+    double bestError = DBL_MAX;
+    for(uint32_t restart = 0 ; restart < SIMPOINT_RESTARTS ; restart++)
+    {
+        double error = simPointKMeans(points, k, random, assignment, centres);
+        if(error < bestError)
+        {
+            bestError = error;
+            bestAssignment = assignment;
+            bestCentres = centres;
+        }
+    }
+
+    for(uint32_t c = 0 ; c < k ; c++)
+    {
+        SimPointCluster cluster;
+        for(uint32_t i = 0 ; i < points.size() ; i++)
+        {
+            if(bestAssignment[i] == c)
+            {
+                cluster.intervals.push_back(i);
+            }
+        }
+        if(cluster.intervals.empty())
+        {
+            continue;
+        }
+
+        std::vector<uint32_t> others = cluster.intervals;
+        auto nearest = std::min_element(others.begin(), others.end(), [&](uint32_t a, uint32_t b)
+        {
+            return simPointDistance(points[a], bestCentres[c]) < simPointDistance(points[b], bestCentres[c]);
+        });
+        cluster.samples.push_back(*nearest);
+        others.erase(nearest);
+        std::shuffle(others.begin(), others.end(), random);
+        for(uint32_t i = 0 ; i < others.size() && cluster.samples.size() < samplesPerCluster ; i++)
+        {
+            cluster.samples.push_back(others[i]);
+        }
+        std::sort(cluster.samples.begin() + 1, cluster.samples.end());
+        clusters.push_back(cluster);
+    }
+    return clusters;
+}
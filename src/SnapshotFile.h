@@ -0,0 +1,167 @@
+#include <iostream>
+#include <vector>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//Snapshots of a simulation, as saveCheckpoint writes them and initSimulatorFromCheckpoint reads
+//them. A snapshot is a header followed by its sections, each starting on a page boundary:
+// - machine: the cycle-accurate simulator apart from its caches and memory.
+// - icache, dcache: the checkpoints of the two caches (see Cache::saveCheckpoint).
+// - arch: just the PC and registers, for a snapshot taken outside the pipeline, as
+//   ./sim --fast-forward does. Such a snapshot has no machine or cache sections.
+// - runs: runCount SnapshotRuns, each a run of memory stored further on in the file.
+//An empty section has size 0. Everything is in the host's own layout and byte order, so writing
+//and reading are a memcpy per section through a mapping of the file. The header records the byte
+//order and struct sizes, and a snapshot from a build that differs in either is refused.
+
+#define SNAPSHOT_VERSION 3
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+#define SNAPSHOT_ALIGN 4096
+#define SNAPSHOT_REGS 32
+
+struct SnapshotSection
+{
+    uint64_t offset;
+    uint64_t size;
+};
+
+//A run of memory: size bytes at address, stored at offset in the file.
+struct SnapshotRun
+{
+    uint32_t address;
+    uint32_t size;
+    uint64_t offset;
+};
+
+struct SnapshotHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t headerSize;
+    //sizeof the machine section's struct in the build that wrote it, or 0 with no machine section.
+    uint32_t machineSize;
+    uint32_t runCount;
+    SnapshotSection machine;
+    SnapshotSection icache;
+    SnapshotSection dcache;
+    SnapshotSection arch;
+    SnapshotSection runs;
+};
+
+//The state a program can see: where it is and what its registers hold, $zero included.
+struct ArchSnapshot
+{
+    uint32_t pc;
+    uint32_t regs[SNAPSHOT_REGS];
+};
+
+inline uint64_t snapshotAlign(uint64_t offset)
+{
+    return (offset + SNAPSHOT_ALIGN - 1) & ~(uint64_t)(SNAPSHOT_ALIGN - 1);
+}
+
+//Starts a header for sections of the given sizes and places them, then the runs, each on its
+//own page. Returns the size of the whole file.
+inline uint64_t layoutSnapshot(SnapshotHeader & header, uint32_t machineSize, uint64_t icacheSize,
+                               uint64_t dcacheSize, uint64_t archSize, std::vector<SnapshotRun> & runs)
+{
+    header = SnapshotHeader{};
+    memcpy(header.magic, "MSNP", 4);
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.headerSize = sizeof(SnapshotHeader);
+    header.machineSize = machineSize;
+    header.runCount = runs.size();
+
+    uint64_t end = sizeof(SnapshotHeader);
+    SnapshotSection *sections[] = {&header.machine, &header.icache, &header.dcache, &header.arch, &header.runs};
+    uint64_t sizes[] = {machineSize, icacheSize, dcacheSize, archSize, runs.size() * sizeof(SnapshotRun)};
+    for(uint32_t i = 0 ; i < 5 ; i++)
+    {
+        *sections[i] = SnapshotSection{sizes[i] ? snapshotAlign(end) : 0, sizes[i]};
+        end = sizes[i] ? sections[i]->offset + sizes[i] : end;
+    }
+    for(SnapshotRun & run : runs)
+    {
+        run.offset = snapshotAlign(end);
+        end = run.offset + run.size;
+    }
+    return end;
+}
+
+//Creates fileName at size bytes and maps it to be written in place, so nothing is copied twice.
+//Returns the mapping, to be unmapped with munmap, or nullptr after saying why.
+inline uint8_t * createSnapshotFile(const char *fileName, uint64_t size)
+{
+    int fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0 || ftruncate(fd, size) != 0)
+    {
+        if(fd >= 0)
+        {
+            close(fd);
+        }
+        std::cout << "Could not create checkpoint file " << fileName << std::endl;
+        return nullptr;
+    }
+    void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED)
+    {
+        std::cout << "Could not create checkpoint file " << fileName << std::endl;
+        return nullptr;
+    }
+    return static_cast<uint8_t *>(mapping);
+}
+
+//Maps fileName to be read, setting size. Returns the mapping, or nullptr after saying why.
+inline const uint8_t * openSnapshotFile(const char *fileName, uint64_t & size)
+{
+    int fd = open(fileName, O_RDONLY);
+    struct stat info;
+    if(fd < 0 || fstat(fd, &info) != 0)
+    {
+        if(fd >= 0)
+        {
+            close(fd);
+        }
+        std::cout << "Could not read checkpoint file " << fileName << std::endl;
+        return nullptr;
+    }
+    size = info.st_size;
+    void *mapping = size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if(mapping == MAP_FAILED)
+    {
+        std::cout << "Could not read checkpoint file " << fileName << std::endl;
+        return nullptr;
+    }
+    return static_cast<const uint8_t *>(mapping);
+}
+
+//Whether a section of a snapshot size bytes long lies inside it.
+inline bool snapshotHolds(uint64_t size, const SnapshotSection & section)
+{
+    return section.offset <= size && section.size <= size - section.offset;
+}
+
+//Whether image, size bytes long, starts with a header this build can read whose sections and
+//runs all lie inside it. Fills in header either way.
+inline bool checkSnapshotHeader(const uint8_t *image, uint64_t size, SnapshotHeader & header)
+{
+    header = SnapshotHeader{};
+    if(size < sizeof(header))
+    {
+        return false;
+    }
+    memcpy(&header, image, sizeof(header));
+    return memcmp(header.magic, "MSNP", 4) == 0 && header.version == SNAPSHOT_VERSION &&
+           header.byteOrder == SNAPSHOT_BYTE_ORDER && header.headerSize == sizeof(SnapshotHeader) &&
+           header.machine.size == header.machineSize && header.runs.size == header.runCount * sizeof(SnapshotRun) &&
+           snapshotHolds(size, header.machine) && snapshotHolds(size, header.icache) &&
+           snapshotHolds(size, header.dcache) && snapshotHolds(size, header.arch) && snapshotHolds(size, header.runs);
+}
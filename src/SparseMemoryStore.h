@@ -0,0 +1,298 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+#include <vector>
+
+//4 KB pages, found through a two-level table: the top 10 bits of the page number pick a
+//directory entry, the bottom 10 a page in that entry's table.
+#define SPARSE_PAGE_BITS 12
+#define SPARSE_PAGE_SIZE (1u << SPARSE_PAGE_BITS)
+#define SPARSE_TABLE_BITS 10
+#define SPARSE_TABLE_SIZE (1u << SPARSE_TABLE_BITS)
+//No page has this number, so it marks the lookaside empty.
+#define SPARSE_NO_PAGE 0xFFFFFFFF
+
+//A memory store covering the whole 32-bit address space. Pages are allocated the first time
+//they are written, and reading one never written gives zeros, so a simulation costs memory in
+//proportion to what it touches rather than where. The last page used is kept aside, which
+//catches most accesses without walking the table. Accesses are big-endian and unaligned ones
+//are allowed, as in the prebuilt store; only one running past the top of the address space
+//is refused.
+class SparseMemoryStore final : public BlockMemoryStore
+{
+    private:
+        uint8_t **directory[SPARSE_TABLE_SIZE];
+        uint32_t lastPageNumber;
+        uint8_t *lastPage;
+        uint32_t pages;
+
+        static bool inRange(uint32_t address, uint32_t size)
+        {
+            return size == 0 || address <= UINT32_MAX - (size - 1);
+        }
+
+        __attribute__((noinline, cold)) static int outOfRange(uint32_t address)
+        {
+            std::cerr << "Address 0x" << std::hex << address << " is out of range" << std::endl;
+            return -EINVAL;
+        }
+
+        __attribute__((noinline, cold)) static int invalidSize()
+        {
+            std::cerr << "Invalid size passed, cannot read/write memory" << std::endl;
+            return -EINVAL;
+        }
+
+        //Walks the table, allocating the page if asked. nullptr for a page never written.
+        __attribute__((noinline)) uint8_t *findPage(uint32_t pageNumber, bool allocate)
+        {
+            uint8_t **& table = directory[pageNumber >> SPARSE_TABLE_BITS];
+            if(!table)
+            {
+                if(!allocate)
+                {
+                    return nullptr;
+                }
+                table = new uint8_t *[SPARSE_TABLE_SIZE]();
+            }
+
+            uint8_t *& page = table[pageNumber & (SPARSE_TABLE_SIZE - 1)];
+            if(!page)
+            {
+                if(!allocate)
+                {
+                    return nullptr;
+                }
+                page = new uint8_t[SPARSE_PAGE_SIZE]();
+                pages++;
+            }
+
+            lastPageNumber = pageNumber;
+            lastPage = page;
+            return page;
+        }
+
+        uint8_t *getPage(uint32_t address, bool allocate)
+        {
+            uint32_t pageNumber = address >> SPARSE_PAGE_BITS;
+            if(__builtin_expect(pageNumber == lastPageNumber, 1))
+            {
+                return lastPage;
+            }
+            return findPage(pageNumber, allocate);
+        }
+
+        static uint32_t pageOffset(uint32_t address)
+        {
+            return address & (SPARSE_PAGE_SIZE - 1);
+        }
+
+    public:
+        SparseMemoryStore() : lastPageNumber(SPARSE_NO_PAGE), lastPage(nullptr), pages(0)
+        {
+            memset(directory, 0, sizeof(directory));
+        }
+
+        SparseMemoryStore(const SparseMemoryStore &) = delete;
+        SparseMemoryStore & operator=(const SparseMemoryStore &) = delete;
+
+        ~SparseMemoryStore()
+        {
+            for(uint32_t i = 0 ; i < SPARSE_TABLE_SIZE ; i++)
+            {
+                if(!directory[i])
+                {
+                    continue;
+                }
+                for(uint32_t j = 0 ; j < SPARSE_TABLE_SIZE ; j++)
+                {
+                    delete[] directory[i][j];
+                }
+                delete[] directory[i];
+            }
+        }
+
+        //How many pages have been allocated, for footprint reports.
+        uint32_t getPageCount()
+        {
+            return pages;
+        }
+
+        //The address of every allocated page, lowest first, for checkpoints.
+        std::vector<uint32_t> getPageAddresses()
+        {
+            std::vector<uint32_t> addresses;
+            for(uint32_t i = 0 ; i < SPARSE_TABLE_SIZE ; i++)
+            {
+                for(uint32_t j = 0 ; directory[i] && j < SPARSE_TABLE_SIZE ; j++)
+                {
+                    if(directory[i][j])
+                    {
+                        addresses.push_back(((i << SPARSE_TABLE_BITS) | j) << SPARSE_PAGE_BITS);
+                    }
+                }
+            }
+            return addresses;
+        }
+
+        template<MemEntrySize size>
+        int read(uint32_t address, uint32_t & value)
+        {
+            if(__builtin_expect(!inRange(address, size), 0))
+            {
+                return outOfRange(address);
+            }
+
+            uint32_t result = 0;
+            if(__builtin_expect(pageOffset(address) + size <= SPARSE_PAGE_SIZE, 1))
+            {
+                const uint8_t *page = getPage(address, false);
+                if(page)
+                {
+                    const uint8_t *bytes = &page[pageOffset(address)];
+                    for(uint32_t i = 0 ; i < size ; i++)
+                    {
+                        result = (result << 8) | bytes[i];
+                    }
+                }
+            }
+            else
+            {
+                //Straddles two pages.
+                for(uint32_t i = 0 ; i < size ; i++)
+                {
+                    uint32_t byte = 0;
+                    read<BYTE_SIZE>(address + i, byte);
+                    result = (result << 8) | byte;
+                }
+            }
+            value = result;
+            return 0;
+        }
+
+        template<MemEntrySize size>
+        int write(uint32_t address, uint32_t value)
+        {
+            if(__builtin_expect(!inRange(address, size), 0))
+            {
+                return outOfRange(address);
+            }
+
+            if(__builtin_expect(pageOffset(address) + size <= SPARSE_PAGE_SIZE, 1))
+            {
+                uint8_t *bytes = &getPage(address, true)[pageOffset(address)];
+                for(uint32_t i = 0 ; i < size ; i++)
+                {
+                    bytes[i] = value >> (8 * (size - 1 - i));
+                }
+            }
+            else
+            {
+                for(uint32_t i = 0 ; i < size ; i++)
+                {
+                    write<BYTE_SIZE>(address + i, value >> (8 * (size - 1 - i)));
+                }
+            }
+            return 0;
+        }
+
+        int getMemValue(uint32_t address, uint32_t & value, MemEntrySize size) override
+        {
+            switch(size)
+            {
+                case BYTE_SIZE:
+                    return read<BYTE_SIZE>(address, value);
+                case HALF_SIZE:
+                    return read<HALF_SIZE>(address, value);
+                case WORD_SIZE:
+                    return read<WORD_SIZE>(address, value);
+                default:
+                    return invalidSize();
+            }
+        }
+
+        int setMemValue(uint32_t address, uint32_t value, MemEntrySize size) override
+        {
+            switch(size)
+            {
+                case BYTE_SIZE:
+                    return write<BYTE_SIZE>(address, value);
+                case HALF_SIZE:
+                    return write<HALF_SIZE>(address, value);
+                case WORD_SIZE:
+                    return write<WORD_SIZE>(address, value);
+                default:
+                    return invalidSize();
+            }
+        }
+
+        //One page at a time. Pages never written read as zeros and are not allocated.
+        int getMemBlock(uint32_t address, uint8_t *data, uint32_t size) override
+        {
+            if(!inRange(address, size))
+            {
+                return outOfRange(address);
+            }
+
+            while(size > 0)
+            {
+                uint32_t chunk = std::min(size, SPARSE_PAGE_SIZE - pageOffset(address));
+                const uint8_t *page = getPage(address, false);
+                if(page)
+                {
+                    memcpy(data, &page[pageOffset(address)], chunk);
+                }
+                else
+                {
+                    memset(data, 0, chunk);
+                }
+                address += chunk;
+                data += chunk;
+                size -= chunk;
+            }
+            return 0;
+        }
+
+        int setMemBlock(uint32_t address, const uint8_t *data, uint32_t size) override
+        {
+            if(!inRange(address, size))
+            {
+                return outOfRange(address);
+            }
+
+            while(size > 0)
+            {
+                uint32_t chunk = std::min(size, SPARSE_PAGE_SIZE - pageOffset(address));
+                memcpy(&getPage(address, true)[pageOffset(address)], data, chunk);
+                address += chunk;
+                data += chunk;
+                size -= chunk;
+            }
+            return 0;
+        }
+
+        bool holds(uint32_t address, uint32_t size) override
+        {
+            return inRange(address, size);
+        }
+
+        int printMemory(uint32_t startAddress, uint32_t endAddress) override
+        {
+            return printMemoryRange(this, startAddress, endAddress, WORD_SIZE, 5, std::cout);
+        }
+};
+
+//As the prebuilt dumpMemoryState, which only takes its own store. Here the range can be anywhere.
+inline void dumpMemoryState(SparseMemoryStore *mem)
+{
+    std::ofstream out("mem_state.out", std::ios::out | std::ios::trunc);
+    if(!out)
+    {
+        std::cerr << "Could not create memory state dump file" << std::endl;
+        return;
+    }
+    printMemoryState(mem, out);
+}
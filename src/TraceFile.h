@@ -0,0 +1,331 @@
+#include <iostream>
+#include <algorithm>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//Binary traces of the memory accesses a simulation makes: every instruction fetch and every
+//data read or write, with its address, size and the cycle it was made in. A cache can be
+//studied by replaying the trace into it, without running the program again.
+//
+//A trace starts with a 12-byte header: "MTRC", then the format version and the clock, each a
+//little-endian 32-bit word. The records follow, one per access, in the order they were made.
+//Each starts with a tag byte:
+// - bits 0-1: the kind of access, a TraceKind.
+// - bits 2-3: log2 of its size in bytes.
+// - bit 4: set when the address is given. Otherwise it is the one just after the previous
+//   access of the same stream (fetches are one stream, reads and writes the other).
+// - bits 5-7: how many cycles after the previous record this one was made, 0 to 6. 7 means
+//   7 or more, with the rest following as a varint.
+//When bit 4 is set, the distance from that predicted address follows, as a zigzag varint. A
+//run of straight-line fetches, one a cycle, takes a byte per instruction.
+
+#define TRACE_VERSION 1
+#define TRACE_HEADER_SIZE 12
+#define TRACE_BUFFER_SIZE 0x10000
+//The longest record: a tag, a 64-bit varint and a 32-bit one.
+#define TRACE_MAX_RECORD 16
+
+#define TRACE_KIND_MASK 0x3
+#define TRACE_SIZE_SHIFT 2
+#define TRACE_ADDRESS_FLAG 0x10
+#define TRACE_CYCLE_SHIFT 5
+#define TRACE_CYCLE_ESCAPE 7
+
+enum TraceKind
+{
+    TRACE_FETCH = 0,
+    TRACE_READ = 1,
+    TRACE_WRITE = 2
+};
+
+//What a trace's cycles count.
+enum TraceClock
+{
+    //Cycles of the cycle-accurate pipeline.
+    TRACE_CYCLES = 0,
+    //Instructions run by the functional simulator; each access has its instruction's number.
+    TRACE_INSTRUCTIONS = 1
+};
+
+struct TraceRecord
+{
+    TraceKind kind;
+    uint32_t address;
+    uint32_t size;
+    uint64_t cycle;
+};
+
+//Where the next access of a stream is expected, and when the last record was made. Writer and
+//reader keep the same one, so they agree on what each record leaves out.
+struct TraceCursor
+{
+    uint32_t nextAddress[2];
+    uint64_t cycle;
+
+    static uint32_t stream(TraceKind kind)
+    {
+        return kind == TRACE_FETCH ? 0 : 1;
+    }
+};
+
+//Writes a trace through a buffer, so recording costs a few bytes of memory traffic per access
+//and a write call every 64 KB.
+class TraceWriter
+{
+    private:
+        int fd;
+        uint8_t buffer[TRACE_BUFFER_SIZE];
+        uint32_t used;
+        TraceCursor cursor;
+        bool failed;
+
+        void putVarint(uint64_t value)
+        {
+            while(value >= 0x80)
+            {
+                buffer[used++] = (value & 0x7f) | 0x80;
+                value >>= 7;
+            }
+            buffer[used++] = value;
+        }
+
+        void putWord(uint32_t value)
+        {
+            for(uint32_t i = 0 ; i < 4 ; i++)
+            {
+                buffer[used++] = value >> (8 * i);
+            }
+        }
+
+        int flush()
+        {
+            for(uint32_t done = 0 ; done < used && !failed ; )
+            {
+                ssize_t written = write(fd, &buffer[done], used - done);
+                if(written < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if(written <= 0)
+                {
+                    std::cout << "Could not write trace file!" << std::endl;
+                    failed = true;
+                    break;
+                }
+                done += written;
+            }
+            used = 0;
+            return failed ? -EIO : 0;
+        }
+
+    public:
+        TraceWriter() : fd(-1), used(0), cursor{}, failed(false) {}
+        TraceWriter(const TraceWriter &) = delete;
+        TraceWriter & operator=(const TraceWriter &) = delete;
+
+        ~TraceWriter()
+        {
+            close();
+        }
+
+        //Starts a trace in fileName, replacing anything there. Returns 0, or -EBADF after saying why.
+        int open(const char *fileName, TraceClock clock)
+        {
+            close();
+            fd = ::open(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if(fd < 0)
+            {
+                std::cout << "Could not open trace file " << fileName << std::endl;
+                return -EBADF;
+            }
+            used = 0;
+            cursor = TraceCursor{};
+            failed = false;
+            memcpy(buffer, "MTRC", 4);
+            used = 4;
+            putWord(TRACE_VERSION);
+            putWord(clock);
+            return 0;
+        }
+
+        //Adds one access. Cycles must not go backwards.
+        void record(TraceKind kind, uint32_t address, uint32_t size, uint64_t cycle)
+        {
+            if(fd < 0)
+            {
+                return;
+            }
+            if(used > TRACE_BUFFER_SIZE - TRACE_MAX_RECORD)
+            {
+                flush();
+            }
+
+            uint32_t &nextAddress = cursor.nextAddress[TraceCursor::stream(kind)];
+            uint64_t cycleDelta = cycle - cursor.cycle;
+            int32_t addressDelta = static_cast<int32_t>(address - nextAddress);
+            uint8_t tag = kind | (__builtin_ctz(size) << TRACE_SIZE_SHIFT)
+                        | (std::min<uint64_t>(cycleDelta, TRACE_CYCLE_ESCAPE) << TRACE_CYCLE_SHIFT);
+            if(addressDelta)
+            {
+                tag |= TRACE_ADDRESS_FLAG;
+            }
+
+            buffer[used++] = tag;
+            if(cycleDelta >= TRACE_CYCLE_ESCAPE)
+            {
+                putVarint(cycleDelta - TRACE_CYCLE_ESCAPE);
+            }
+            if(addressDelta)
+            {
+                putVarint((static_cast<uint32_t>(addressDelta) << 1) ^ static_cast<uint32_t>(addressDelta >> 31));
+            }
+
+            nextAddress = address + size;
+            cursor.cycle = cycle;
+        }
+
+        //Writes out what is buffered and closes the file. Returns 0, or -EIO if any write failed.
+        int close()
+        {
+            if(fd < 0)
+            {
+                return 0;
+            }
+            int ret = flush();
+            ::close(fd);
+            fd = -1;
+            return ret;
+        }
+};
+
+//Reads a trace back, straight from a mapping of the file.
+class TraceReader
+{
+    private:
+        const uint8_t *image;
+        size_t size;
+        size_t offset;
+        TraceClock clock;
+        TraceCursor cursor;
+        bool truncated;
+
+        bool getVarint(uint64_t & value)
+        {
+            value = 0;
+            for(uint32_t shift = 0 ; shift < 64 ; shift += 7)
+            {
+                if(offset >= size)
+                {
+                    return false;
+                }
+                uint8_t byte = image[offset++];
+                value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                if(!(byte & 0x80))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        uint32_t getWord(size_t at)
+        {
+            return image[at] | (image[at + 1] << 8) | (image[at + 2] << 16) | ((uint32_t) image[at + 3] << 24);
+        }
+
+    public:
+        TraceReader() : image(nullptr), size(0), offset(0), clock(TRACE_CYCLES), cursor{}, truncated(false) {}
+        TraceReader(const TraceReader &) = delete;
+        TraceReader & operator=(const TraceReader &) = delete;
+
+        ~TraceReader()
+        {
+            if(image)
+            {
+                munmap(const_cast<uint8_t *>(image), size);
+            }
+        }
+
+        //Maps fileName and checks its header. Returns 0, or -EINVAL after saying why.
+        int open(const char *fileName)
+        {
+            int fd = ::open(fileName, O_RDONLY);
+            struct stat info;
+            if(fd < 0 || fstat(fd, &info) != 0 || info.st_size < TRACE_HEADER_SIZE)
+            {
+                if(fd >= 0)
+                {
+                    ::close(fd);
+                }
+                std::cout << "Could not read trace file " << fileName << std::endl;
+                return -EINVAL;
+            }
+
+            size = info.st_size;
+            void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if(mapping == MAP_FAILED)
+            {
+                std::cout << "Could not read trace file " << fileName << std::endl;
+                return -EINVAL;
+            }
+            image = static_cast<const uint8_t *>(mapping);
+
+            if(memcmp(image, "MTRC", 4) != 0 || getWord(4) != TRACE_VERSION)
+            {
+                std::cout << fileName << " is not a version " << TRACE_VERSION << " trace" << std::endl;
+                return -EINVAL;
+            }
+            clock = static_cast<TraceClock>(getWord(8));
+            offset = TRACE_HEADER_SIZE;
+            return 0;
+        }
+
+        TraceClock getClock()
+        {
+            return clock;
+        }
+
+        //Whether reading stopped partway through a record, as in a trace cut short.
+        bool isTruncated()
+        {
+            return truncated;
+        }
+
+        //The next record, or false at the end of the trace.
+        bool next(TraceRecord & record)
+        {
+            if(offset >= size)
+            {
+                return false;
+            }
+
+            uint8_t tag = image[offset++];
+            record.kind = static_cast<TraceKind>(tag & TRACE_KIND_MASK);
+            record.size = 1u << ((tag >> TRACE_SIZE_SHIFT) & 0x3);
+
+            uint64_t cycleDelta = tag >> TRACE_CYCLE_SHIFT;
+            uint64_t rest = 0;
+            uint64_t zigzag = 0;
+            if((cycleDelta == TRACE_CYCLE_ESCAPE && !getVarint(rest)) ||
+               ((tag & TRACE_ADDRESS_FLAG) && !getVarint(zigzag)))
+            {
+                truncated = true;
+                offset = size;
+                return false;
+            }
+
+            uint32_t &nextAddress = cursor.nextAddress[TraceCursor::stream(record.kind)];
+            int32_t addressDelta = static_cast<int32_t>((zigzag >> 1) ^ -(zigzag & 1));
+            record.address = nextAddress + addressDelta;
+            record.cycle = cursor.cycle + cycleDelta + rest;
+
+            nextAddress = record.address + record.size;
+            cursor.cycle = record.cycle;
+            return true;
+        }
+};
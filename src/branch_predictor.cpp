@@ -0,0 +1,110 @@
+#include "BranchConfig.h"
+#include "branch_predictor.h"
+
+#define COUNTER_MAX 3
+#define WEAKLY_NOT_TAKEN 1
+
+static void trainCounter(uint8_t &counter, bool taken) {
+    if (taken && counter < COUNTER_MAX) counter++;
+    if (!taken && counter > 0) counter--;
+}
+
+bool StaticNotTakenPredictor::predict(uint32_t /* pc */) {
+    return false;
+}
+
+void StaticNotTakenPredictor::update(uint32_t /* pc */, bool /* taken */) {}
+
+BimodalPredictor::BimodalPredictor(uint32_t tableSize) : counters(tableSize ? tableSize : 1, WEAKLY_NOT_TAKEN) {}
+
+bool BimodalPredictor::predict(uint32_t pc) {
+    return counters[(pc >> 2) % counters.size()] > WEAKLY_NOT_TAKEN;
+}
+
+void BimodalPredictor::update(uint32_t pc, bool taken) {
+    trainCounter(counters[(pc >> 2) % counters.size()], taken);
+}
+
+GsharePredictor::GsharePredictor(uint32_t tableSize, uint32_t historyBits)
+    : counters(tableSize ? tableSize : 1, WEAKLY_NOT_TAKEN), history(0),
+      historyMask(historyBits >= 32 ? UINT32_MAX : (1u << historyBits) - 1) {}
+
+bool GsharePredictor::predict(uint32_t pc) {
+    return counters[index(pc)] > WEAKLY_NOT_TAKEN;
+}
+
+void GsharePredictor::update(uint32_t pc, bool taken) {
+    trainCounter(counters[index(pc)], taken);
+    history = ((history << 1) | taken) & historyMask;
+}
+
+// the chooser starts weakly on bimodal, which warms up faster
+TournamentPredictor::TournamentPredictor(uint32_t tableSize, uint32_t historyBits)
+    : bimodal(tableSize), gshare(tableSize, historyBits), chooser(tableSize ? tableSize : 1, WEAKLY_NOT_TAKEN) {}
+
+bool TournamentPredictor::predict(uint32_t pc) {
+    bool useGshare = chooser[(pc >> 2) % chooser.size()] > WEAKLY_NOT_TAKEN;
+    return useGshare ? gshare.predict(pc) : bimodal.predict(pc);
+}
+
+void TournamentPredictor::update(uint32_t pc, bool taken) {
+    bool bimodalGuess = bimodal.predict(pc);
+    bool gshareGuess = gshare.predict(pc);
+    if (bimodalGuess != gshareGuess) {
+        trainCounter(chooser[(pc >> 2) % chooser.size()], gshareGuess == taken);
+    }
+    bimodal.update(pc, taken);
+    gshare.update(pc, taken);
+}
+
+BranchTargetBuffer::BranchTargetBuffer(uint32_t numEntries) : entries(numEntries, BtbEntry{}) {}
+
+bool BranchTargetBuffer::lookup(uint32_t pc, uint32_t &target) {
+    if (entries.empty()) return false;
+    BtbEntry &entry = entries[(pc >> 2) % entries.size()];
+    if (!entry.valid || entry.pc != pc) return false;
+    target = entry.target;
+    return true;
+}
+
+void BranchTargetBuffer::update(uint32_t pc, uint32_t target) {
+    if (entries.empty()) return;
+    entries[(pc >> 2) % entries.size()] = BtbEntry{true, pc, target};
+}
+
+ReturnAddressStack::ReturnAddressStack(uint32_t depth) : stack(depth, 0), top(0), count(0) {}
+
+void ReturnAddressStack::push(uint32_t address) {
+    if (stack.empty()) return;
+    top = (top + 1) % stack.size();
+    stack[top] = address;
+    if (count < stack.size()) count++;
+}
+
+bool ReturnAddressStack::peek(uint32_t &address) {
+    if (count == 0) return false;
+    address = stack[top];
+    return true;
+}
+
+void ReturnAddressStack::pop() {
+    if (count == 0) return;
+    top = (top + stack.size() - 1) % stack.size();
+    count--;
+}
+
+BranchPredictor *createBranchPredictor(BranchPredictorType type, uint32_t tableSize, uint32_t historyBits) {
+    switch (type) {
+        case STATIC_NOT_TAKEN:
+            return new StaticNotTakenPredictor();
+        case BIMODAL:
+            return new BimodalPredictor(tableSize);
+        case GSHARE:
+            return new GsharePredictor(tableSize, historyBits);
+        case TOURNAMENT:
+            return new TournamentPredictor(tableSize, historyBits);
+        case NO_PREDICTION:
+        default:
+            return nullptr;
+    }
+}
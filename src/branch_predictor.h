@@ -0,0 +1,87 @@
+#include <inttypes.h>
+#include <vector>
+
+using std::vector;
+
+// Guesses whether the conditional branch at pc is taken. Every conditional branch is trained
+// with its real outcome once it resolves, in program order.
+class BranchPredictor {
+    public:
+        virtual ~BranchPredictor() {}
+        virtual bool predict(uint32_t pc) = 0;
+        virtual void update(uint32_t pc, bool taken) = 0;
+};
+
+// always falls through
+class StaticNotTakenPredictor : public BranchPredictor {
+    public:
+        bool predict(uint32_t pc);
+        void update(uint32_t pc, bool taken);
+};
+
+// a table of 2-bit saturating counters indexed by pc, starting weakly not taken
+class BimodalPredictor : public BranchPredictor {
+    private:
+        vector<uint8_t> counters;
+    public:
+        BimodalPredictor(uint32_t tableSize);
+        bool predict(uint32_t pc);
+        void update(uint32_t pc, bool taken);
+};
+
+// 2-bit counters indexed by pc xor the last historyBits branch outcomes
+class GsharePredictor : public BranchPredictor {
+    private:
+        vector<uint8_t> counters;
+        uint32_t history, historyMask;
+        uint32_t index(uint32_t pc) { return ((pc >> 2) ^ history) % counters.size(); }
+    public:
+        GsharePredictor(uint32_t tableSize, uint32_t historyBits);
+        bool predict(uint32_t pc);
+        void update(uint32_t pc, bool taken);
+};
+
+// bimodal and gshare, with a per-pc 2-bit chooser that moves toward whichever of them was right
+// when they disagree
+class TournamentPredictor : public BranchPredictor {
+    private:
+        BimodalPredictor bimodal;
+        GsharePredictor gshare;
+        vector<uint8_t> chooser;
+    public:
+        TournamentPredictor(uint32_t tableSize, uint32_t historyBits);
+        bool predict(uint32_t pc);
+        void update(uint32_t pc, bool taken);
+};
+
+// direct-mapped, pc-tagged targets of the last jr seen at each pc
+class BranchTargetBuffer {
+    private:
+        struct BtbEntry {
+            bool valid;
+            uint32_t pc;
+            uint32_t target;
+        };
+        vector<BtbEntry> entries;
+    public:
+        BranchTargetBuffer(uint32_t numEntries);
+        // false when pc has no entry
+        bool lookup(uint32_t pc, uint32_t &target);
+        void update(uint32_t pc, uint32_t target);
+};
+
+// return addresses pushed by jal and popped by jr $ra. a full stack drops its oldest entry
+class ReturnAddressStack {
+    private:
+        vector<uint32_t> stack;
+        uint32_t top, count;
+    public:
+        ReturnAddressStack(uint32_t depth);
+        void push(uint32_t address);
+        // false when the stack is empty
+        bool peek(uint32_t &address);
+        void pop();
+};
+
+// nullptr for NO_PREDICTION
+BranchPredictor *createBranchPredictor(BranchPredictorType type, uint32_t tableSize, uint32_t historyBits);
@@ -4,14 +4,22 @@
 #include <string.h>
 #include <errno.h>
 #include <math.h> 
+#include <algorithm>
 #include "MemoryStore.h"
+#include "FlatMemoryStore.h"
 #include "RegisterInfo.h"
 #include "EndianHelpers.h"
 #include "DriverFunctions.h"
 
 #include "cache_sim.h"
+#include "replacement_policy.h"
+#include "prefetcher.h"
+#include "stack_distance.h"
 
 #define ADDRESS_LEN 32 
+#define INVALID_TAG 0xFFFFFFFF
+// cycles to swap a block back in from the victim cache
+#define VICTIM_HIT_LATENCY 1
 
 using std::vector;
 
@@ -19,244 +27,727 @@ using std::vector;
 Cache::Cache(CacheConfig &config, MemoryStore *mem) {
     hits = 0;
     misses = 0;
+    writebacks = 0;
+    replays = 0;
     blockSize = config.blockSize;
     cacheSize= config.cacheSize;
     missLatency = config.missLatency;
     cacheType = config.type;
     mainMem = mem;
+    flatMem = dynamic_cast<FlatMemoryStore *>(mem);
     numBlocks = cacheSize/blockSize;
-    if(cacheType == TWO_WAY_SET_ASSOC) {
-        assoc = 2;
-    } else {
-        assoc = 1;
+    switch(cacheType) {
+        case TWO_WAY_SET_ASSOC:
+            assoc = 2;
+            break;
+        case SET_ASSOC:
+            assoc = config.associativity ? std::min(config.associativity, numBlocks) : 1;
+            break;
+        case FULLY_ASSOC:
+            assoc = numBlocks;
+            break;
+        default:
+            assoc = 1;
     }
-    if(cacheType == TWO_WAY_SET_ASSOC) {
-        numSets = numBlocks/2;
-    } else {
-        numSets = numBlocks;
-    }
-    for (uint32_t i = 0; i < numSets; i++) {
-        metaDataBits.emplace_back();
-        for (uint32_t j = 0; j < assoc; j++) {
-            metaDataBits[i].emplace_back();
-            // metaDataBits[i][j].tag = 0;
-            // metaDataBits[i][j].dirty  = 0;
-            // metaDataBits[i][j].lru = 0;
-        }
+    numSets = numBlocks/assoc;
+    // one allocation each for metadata, tags and data, zero-initialized
+    metaDataBits.assign(numSets * assoc, metaData{});
+    tagBits.assign(numSets * assoc, INVALID_TAG);
+    cacheData.assign(numSets * assoc * blockSize, 0);
+    replacement = createReplacementPolicy(config.replacement, numSets, assoc);
+    inclusion = config.inclusion;
+    nextLevel = nullptr;
+    mshrReady.assign(config.mshrs, 0);
+    mshrCoveredUntil = 0;
+    mshrStats = MshrStats{};
+    prefetcher = createPrefetcher(config.prefetcher, blockSize, config.prefetchDegree, config.prefetchDistance);
+    prefetchStats = PrefetchStats{};
+    prefetching = false;
+    prefetchTrigger = false;
+    replayPending = false;
+    replayAddress = 0;
+    profiler = nullptr;
+    victimBlocks = config.victimBlocks;
+    victimMeta.assign(victimBlocks, metaData{});
+    victimTags.assign(victimBlocks, INVALID_TAG);
+    victimData.assign(victimBlocks * blockSize, 0);
+    victimReplacement = victimBlocks ? createReplacementPolicy(LRU, 1, victimBlocks) : nullptr;
+    victimStats = VictimCacheStats{};
+    swapBlock.assign(victimBlocks ? blockSize : 0, 0);
+    writeBufferEntries = config.writeBufferEntries;
+    writebackLatency = config.writebackLatency;
+    writeBufferStats = WriteBufferStats{};
+
+    offsetEnd   = log2(blockSize);
+    offsetMask  = blockSize - 1;
+    indexMask   = numSets - 1;
+    setsPowerOfTwo = (numSets & indexMask) == 0;
+}
+
+// address given is the address of the first byte
+int Cache::getCacheValue(uint32_t address, uint32_t & value, MemEntrySize size, uint32_t cycle, uint32_t pc){
+    uint8_t bytes[WORD_SIZE];
+    int result = access(address, bytes, size, false, cycle, pc);
+
+    // the data only arrives once the fill completes and the access is replayed
+    value = 0;
+    if (result) return result;
+
+    // bytes are stored big-endian, most significant first
+    for (uint32_t i = 0; i < size; i++) {
+        value = (value << 8) | bytes[i];
     }
+    return result;
+}
 
-    for (uint32_t i = 0; i < numSets; i++) {
-        cacheData.emplace_back();        
-        for (uint32_t j = 0; j < assoc; j++) {
-            cacheData[i].emplace_back();
-            for (uint32_t k = 0; k<blockSize; k++) {
-                cacheData[i][j].emplace_back();
-            }
-        }
+int Cache::setCacheValue(uint32_t address, uint32_t value, MemEntrySize size, uint32_t cycle, uint32_t pc) {
+    uint8_t bytes[WORD_SIZE];
+    for (uint32_t i = 0; i < size; i++) {
+        bytes[i] = (uint8_t) (value >> ((size-1-i)*8));
     }
+    return access(address, bytes, size, true, cycle, pc);
+}
 
+int Cache::getCacheValue(uint32_t address, uint32_t & value, MemEntrySize size, uint32_t cycle, uint32_t &readyCycle, uint32_t pc) {
+    uint8_t bytes[WORD_SIZE];
+    int result = accessNonBlocking(address, bytes, size, false, cycle, readyCycle, pc);
 
-    offsetStart = 0;
-    offsetEnd   = log2(blockSize);
-    indexStart  = log2(blockSize);
-    indexEnd    = indexStart + log2(numSets);
-    tagStart    = indexStart + log2(numSets);
-    tagEnd      = ADDRESS_LEN;
-    
+    value = 0;
+    if (result) return result;
+
+    for (uint32_t i = 0; i < size; i++) {
+        value = (value << 8) | bytes[i];
+    }
+    return result;
 }
 
- // address given is the address of the first byte
-int Cache::getCacheValue(uint32_t address, uint32_t & value, MemEntrySize size, uint32_t cycle){
-    int result;
-    value = 0;
+int Cache::setCacheValue(uint32_t address, uint32_t value, MemEntrySize size, uint32_t cycle, uint32_t &readyCycle, uint32_t pc) {
+    uint8_t bytes[WORD_SIZE];
+    for (uint32_t i = 0; i < size; i++) {
+        bytes[i] = (uint8_t) (value >> ((size-1-i)*8));
+    }
+    return accessNonBlocking(address, bytes, size, true, cycle, readyCycle, pc);
+}
 
-    // look at each byte  
-    for(uint32_t i = 0; i< size; i++){
-        uint32_t byteAddr = address+i;
-        uint32_t byte;
-        result = getCacheByte(byteAddr, byte, cycle);
-        if(i ==0){
-            if(result == 0) {
+// splits an access at block boundaries so each piece needs a single lookup. hits and misses
+// are counted by the first block touched, and the delay returned is that of the last block
+int Cache::access(uint32_t address, uint8_t *bytes, uint32_t size, bool write, uint32_t cycle, uint32_t pc) {
+    int result = 0;
+    prefetchTrigger = false;
+    for (uint32_t done = 0; done < size; ) {
+        uint32_t chunk = std::min(size - done, blockSize - ((address + done) & offsetMask));
+        result = accessBlock(address + done, bytes + done, chunk, write, cycle);
+        if (done == 0) {
+            if (result == 0) {
                 hits++;
             } else {
                 misses++;
-                hits--;
+                replays++;
             }
         }
-        value = value | (byte << ((size-1-i)*8));
+        done += chunk;
+    }
+
+    // the replay of a miss is the same access again, so the prefetcher and profiler only see it the first time
+    bool replay = replayPending && replayAddress == address;
+    replayPending = result != 0;
+    replayAddress = address;
+    if (!replay) {
+        if (profiler) profiler->access(address, size);
+        if (prefetcher) issuePrefetches(address, pc, cycle);
     }
     return result;
 }
 
-    // cache read miss procedure:
-    // check the dirty bit if its 1 we write back, if its 0 we dont write back
-    // overwrite contents of cache block by grabbing data from memory
-    // overwrite the tag in our metadata 
-    // when replacing :  make valid bit 1,  dirty bit 0,  update lru 
-    // make a helper function to run the cache miss procedure (use for both getCacheValue and setCacheValue)
-    // write miss
-    // set dirty to 1 every time you write the cache line
-    
-    // do we count the hits for each byte or for each word?
-    // what should we be returning for the getCache function? the value of the word?
-    
-
-int Cache::setCacheValue(uint32_t address, uint32_t value, MemEntrySize size, uint32_t cycle) {
-    uint32_t mask = 0xFF;
-    int result;
-    for (uint32_t i = 0; i < size; i++) {
-        uint32_t byte = (value & (mask << ((size-1-i)*8))) >> ((size-1-i)*8);
-        //uint32_t byte;
-        result = setCacheByte(address + i, byte, cycle);
-        if(i ==0){
-            if(result == 0) {
+// reads or writes size bytes that all lie in the block holding address
+int Cache::accessBlock(uint32_t address, uint8_t *bytes, uint32_t size, bool write, uint32_t cycle) {
+    uint32_t addrTag = addressTag(address);
+    uint32_t addrIndex = addressIndex(address);
+    uint32_t blockOffset = address & offsetMask;
+    metaData *meta = setMeta(addrIndex);
+
+    int i = findBlock(addrIndex, addrTag);
+    if (i >= 0) {
+        if (meta[i].prefetched) notePrefetchUse(meta[i], cycle);
+        if (meta[i].cycleReady > cycle) {
+            return meta[i].cycleReady - cycle; // we've hit before, but are emulating latency
+        }
+        copyBytes(blockData(addrIndex, i) + blockOffset, bytes, size, write);
+        if (write) meta[i].dirty = 1;
+        replacement->touch(addrIndex, i);
+        return 0;
+    }
+
+    // gets data from memory after a cache miss
+    notePrefetchMiss(address);
+    uint32_t delay;
+    uint32_t newBlock = cacheMiss(address, addrTag, addrIndex, delay, cycle);
+    if (write) {
+        memcpy(blockData(addrIndex, newBlock) + blockOffset, bytes, size);
+        meta[newBlock].dirty = 1;
+    }
+    meta[newBlock].cycleReady = cycle + delay;
+    return delay;
+}
+
+// a miss claims an MSHR and fills the block right away, so the data moves now and only its timing
+// is deferred. a block still being filled has an MSHR already, and accesses to it merge into that
+// one. hits and misses are counted by the first block touched, as in access
+int Cache::accessNonBlocking(uint32_t address, uint8_t *bytes, uint32_t size, bool write, uint32_t cycle, uint32_t &readyCycle, uint32_t pc) {
+    // every block this access would start fetching needs an MSHR of its own
+    uint32_t needed = 0;
+    for (uint32_t done = 0; done < size; ) {
+        uint32_t addr = address + done;
+        if (findBlock(addressIndex(addr), addressTag(addr)) < 0) needed++;
+        done += std::min(size - done, blockSize - (addr & offsetMask));
+    }
+    uint32_t freeMshrs = 0, firstFree = UINT32_MAX;
+    for (uint32_t ready : mshrReady) {
+        if (ready <= cycle) freeMshrs++;
+        else firstFree = std::min(firstFree, ready);
+    }
+    if (std::min<uint32_t>(needed, mshrReady.size()) > freeMshrs) {
+        mshrStats.fullStalls++;
+        return firstFree - cycle;
+    }
+
+    readyCycle = cycle;
+    prefetchTrigger = false;
+    if (profiler) profiler->access(address, size);
+    for (uint32_t done = 0; done < size; ) {
+        uint32_t addr = address + done;
+        uint32_t chunk = std::min(size - done, blockSize - (addr & offsetMask));
+        uint32_t addrTag = addressTag(addr);
+        uint32_t addrIndex = addressIndex(addr);
+        metaData *meta = setMeta(addrIndex);
+        bool hit = true;
+
+        int way = findBlock(addrIndex, addrTag);
+        if (way >= 0) {
+            if (meta[way].prefetched) notePrefetchUse(meta[way], cycle);
+            if (meta[way].cycleReady > cycle) {
+                mshrStats.merges++;
+                hit = false;
+            }
+            replacement->touch(addrIndex, way);
+        } else {
+            notePrefetchMiss(addr);
+            uint32_t delay;
+            way = cacheMiss(addr, addrTag, addrIndex, delay, cycle);
+            meta[way].cycleReady = cycle + delay;
+            hit = false;
+
+            for (uint32_t &ready : mshrReady) {
+                if (ready <= cycle) {
+                    ready = cycle + delay;
+                    break;
+                }
+            }
+            // misses are claimed in cycle order, so the cycles with a miss outstanding only grow at the end
+            mshrStats.busyCycles += delay;
+            if (cycle + delay > mshrCoveredUntil) {
+                mshrStats.missCycles += cycle + delay - std::max(cycle, mshrCoveredUntil);
+                mshrCoveredUntil = cycle + delay;
+            }
+        }
+
+        copyBytes(blockData(addrIndex, way) + (addr & offsetMask), bytes + done, chunk, write);
+        if (write) meta[way].dirty = 1;
+        readyCycle = std::max(readyCycle, meta[way].cycleReady);
+
+        if (done == 0) {
+            if (hit) {
                 hits++;
             } else {
                 misses++;
-                hits--;
             }
         }
+        done += chunk;
     }
-    return result;
+
+    if (prefetcher) issuePrefetches(address, pc, cycle);
+    return 0;
 }
 
-int Cache::getCacheByte(uint32_t address, uint32_t & value, uint32_t cycle){
-    uint32_t addressCopy = address;
-    uint32_t addrTag = addressCopy << (ADDRESS_LEN - tagEnd) >> (ADDRESS_LEN-tagEnd) >> (tagStart);
-    addressCopy = address;
-    uint32_t addrIndex = addressCopy << (ADDRESS_LEN - indexEnd) >> (ADDRESS_LEN - indexEnd) >> indexStart;
-    addressCopy = address;
-    uint32_t blockOffset = addressCopy << (ADDRESS_LEN - offsetEnd) >> (ADDRESS_LEN - offsetEnd) >> offsetStart;
-
-        // iterate through each block in a set
-       for (uint32_t i = 0; i< assoc; i++) {
-        // read Hit
-        if(metaDataBits[addrIndex][i].valid  && metaDataBits[addrIndex][i].tag == addrTag) {
-            if (metaDataBits[addrIndex][i].cycleReady > cycle) return missLatency;
-            value = cacheData[addrIndex][i][blockOffset];
-            updateLRU(addrIndex, i);
-            // helper function to keep track of LRU block for each set in cache
-           // updateLRU();
-            return 0;
-        } 
+// the first demand access to a prefetched block, which counts as useful if the block had arrived
+void Cache::notePrefetchUse(metaData &meta, uint32_t cycle) {
+    if (meta.cycleReady > cycle) {
+        prefetchStats.late++;
+    } else {
+        prefetchStats.useful++;
+    }
+    meta.prefetched = 0;
+    prefetchTrigger = true;
+}
+
+// a demand miss, which a prefetch caused if it evicted this block
+void Cache::notePrefetchMiss(uint32_t address) {
+    prefetchTrigger = true;
+    if (prefetcher && prefetchVictims.erase(address & ~offsetMask)) {
+        prefetchStats.pollution++;
+    }
+}
+
+// trains the prefetcher on a demand access and fills the blocks it asks for that are not here yet
+void Cache::issuePrefetches(uint32_t address, uint32_t pc, uint32_t cycle) {
+    prefetchCandidates.clear();
+    prefetcher->train(address, pc, prefetchTrigger, prefetchCandidates);
+
+    for (uint32_t candidate : prefetchCandidates) {
+        uint32_t blockAddr = candidate & ~offsetMask;
+        // a block the memory would refuse, such as the prebuilt store's top one, is not prefetched
+        if (!memoryHolds(mainMem, blockAddr, blockSize)) continue;
+
+        uint32_t addrTag = addressTag(blockAddr);
+        uint32_t addrIndex = addressIndex(blockAddr);
+        if (findBlock(addrIndex, addrTag) >= 0) continue;
+
+        prefetchVictims.erase(blockAddr);
+        prefetching = true;
+        uint32_t delay;
+        uint32_t way = cacheMiss(blockAddr, addrTag, addrIndex, delay, cycle);
+        prefetching = false;
+
+        metaData &meta = setMeta(addrIndex)[way];
+        meta.cycleReady = cycle + delay;
+        meta.prefetched = 1;
+        prefetchStats.issued++;
+    }
+}
+
+// the way in a set holding tag, or -1
+int Cache::findBlock(uint32_t addrIndex, uint32_t tag) {
+    const metaData *meta = setMeta(addrIndex);
+    const uint32_t *tags = setTags(addrIndex);
+    // iterate through each block in a set
+    for (uint32_t i = 0; i < assoc; i++) {
+        if (tags[i] == tag && meta[i].valid) {
+            return i;
+        }
     }
-    // gets data from memory after a cache miss 
-    uint32_t newBlock = cacheMiss(addressCopy, addrTag, addrIndex, blockOffset);
-    value = cacheData[addrIndex][newBlock][blockOffset];
-    metaDataBits[addrIndex][newBlock].cycleReady = cycle + missLatency;
-    return missLatency;
+    return -1;
 }
 
-int Cache::setCacheByte(uint32_t address, uint32_t value, uint32_t cycle) {
-    uint32_t addressCopy = address;
-    uint32_t addrTag = (ADDRESS_LEN - tagEnd) >> (ADDRESS_LEN-tagEnd) >> (tagStart);
-    addressCopy = address;
-    uint32_t addrIndex = (addressCopy << (ADDRESS_LEN - indexEnd)) >> (ADDRESS_LEN - indexEnd) >> indexStart;
-    addressCopy = address;
-    uint32_t blockOffset = addressCopy << (ADDRESS_LEN - offsetEnd) >> (ADDRESS_LEN - offsetEnd) >> offsetStart;
+// fills the block holding address from the level below. delay is set to this level's miss
+// latency plus whatever the levels below add, or to the victim cache's latency when the block
+// is there, plus any wait for the writeback of the block evicted
+uint32_t Cache::cacheMiss(uint32_t address, uint32_t tag, uint32_t addrIndex, uint32_t &delay, uint32_t cycle) {
+    metaData *meta = setMeta(addrIndex);
+    uint32_t blockStartMemAddr = (address >> offsetEnd) << offsetEnd; // removing byte offset from address
+
+    // take the block out of the victim cache before making room, since the block evicted
+    // for it may go into that same slot
+    bool dirty = false;
+    int victim = findVictim(blockStartMemAddr);
+    if (victim >= 0) {
+        memcpy(swapBlock.data(), victimBlock(victim), blockSize);
+        dirty = victimMeta[victim].dirty;
+        victimMeta[victim].valid = 0;
+        victimMeta[victim].dirty = 0;
+        victimTags[victim] = INVALID_TAG;
+    }
+
+    uint32_t stall = 0;
+    uint32_t setBlock = allocateBlock(addrIndex, cycle, stall);
+    if (victim >= 0) {
+        memcpy(blockData(addrIndex, setBlock), swapBlock.data(), blockSize);
+        delay = stall + VICTIM_HIT_LATENCY;
+        victimStats.hits++;
+        victimStats.savedCycles += missLatency > VICTIM_HIT_LATENCY ? missLatency - VICTIM_HIT_LATENCY : 0;
+    } else {
+        // read the whole block from below over the old data
+        delay = stall + missLatency + readBelow(blockStartMemAddr, blockData(addrIndex, setBlock), blockSize, cycle, dirty);
+    }
+
+    meta[setBlock].dirty = dirty;
+    meta[setBlock].valid = 1;
+    meta[setBlock].prefetched = 0;
+    replacement->fill(addrIndex, setBlock);
+    setTags(addrIndex)[setBlock] = tag;
+    return setBlock;
+}
 
-    // loop through blocks in the set, starting at startBlock
+// frees a block in a set for a fill: an empty one if the set has one, otherwise the replacement
+// policy's victim, which is evicted first. stall is set to how long the eviction holds up the fill
+uint32_t Cache::allocateBlock(uint32_t addrIndex, uint32_t cycle, uint32_t &stall) {
+    metaData *meta = setMeta(addrIndex);
+    stall = 0;
     for (uint32_t i = 0; i < assoc; i++) {
-        if (metaDataBits[addrIndex][i].valid  && metaDataBits[addrIndex][i].tag == addrTag) { // WRITE HIT
-            if (metaDataBits[addrIndex][i].cycleReady > cycle) {
-                return missLatency; // we've hit before, but are emulating latency 
-            }
-            cacheData[addrIndex][i][blockOffset] = (uint8_t) value;
-            metaDataBits[addrIndex][i].dirty = 1;
-            updateLRU(addrIndex, i);
+        if (!meta[i].valid) {
+            return i;
+        }
+    }
+    uint32_t setBlock = assoc == 1 ? 0 : replacement->victim(addrIndex);
+    stall = evictBlock(addrIndex, setBlock, cycle);
+    return setBlock;
+}
+
+// drops a valid block into the victim cache, or out of this level when there is none. returns
+// how long the fill waits for it
+uint32_t Cache::evictBlock(uint32_t addrIndex, uint32_t way, uint32_t cycle) {
+    metaData &meta = setMeta(addrIndex)[way];
+    uint32_t memAddr = blockAddress(addrIndex, way);
+    uint8_t *data = blockData(addrIndex, way);
+
+    if (meta.prefetched) prefetchStats.useless++;
+    if (prefetching) prefetchVictims.insert(memAddr);
+
+    uint32_t stall;
+    if (victimBlocks) {
+        stall = spillVictim(memAddr, data, meta.dirty, cycle);
+    } else {
+        stall = retireBlock(memAddr, data, meta.dirty, cycle);
+    }
+
+    meta.valid = 0;
+    meta.dirty = 0;
+    meta.prefetched = 0;
+    setTags(addrIndex)[way] = INVALID_TAG;
+    return stall;
+}
+
+// the victim cache slot holding the block at address, or -1
+int Cache::findVictim(uint32_t address) {
+    for (uint32_t i = 0; i < victimBlocks; i++) {
+        if (victimTags[i] == address && victimMeta[i].valid) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// keeps a block evicted from the cache proper in the victim cache, whose own oldest block
+// leaves this level to make room
+uint32_t Cache::spillVictim(uint32_t address, const uint8_t *data, bool dirty, uint32_t cycle) {
+    uint32_t stall = 0;
+    uint32_t slot = victimBlocks;
+    for (uint32_t i = 0; i < victimBlocks; i++) {
+        if (!victimMeta[i].valid) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot == victimBlocks) {
+        slot = victimReplacement->victim(0);
+        victimStats.evictions++;
+        stall = retireBlock(victimTags[slot], victimBlock(slot), victimMeta[slot].dirty, cycle);
+    }
+
+    memcpy(victimBlock(slot), data, blockSize);
+    victimMeta[slot] = metaData{true, dirty, false, 0};
+    victimTags[slot] = address;
+    victimReplacement->fill(0, slot);
+    return stall;
+}
+
+// sends a block leaving this level down when the level below needs it, and returns how long the
+// fill that evicted it waits for the writeback
+uint32_t Cache::retireBlock(uint32_t address, uint8_t *data, bool dirty, uint32_t cycle) {
+    // an inclusive level takes the block away from the caches above as well, along with any
+    // newer data they had for it
+    if (inclusion == INCLUSIVE) {
+        for (Cache *upper : upperLevels) {
+            upper->invalidateBlocks(address, data, blockSize, dirty);
+        }
+    }
+
+    // an exclusive level below takes every victim, otherwise only dirty ones are written back
+    if (nextLevel && nextLevel->inclusion == EXCLUSIVE) {
+        nextLevel->writebackBlock(address, data, blockSize, dirty);
+        if (dirty) writebacks++;
+    } else if (dirty) {
+        writeBelow(address, data, blockSize);
+    }
+    return dirty ? bufferWriteback(address, cycle) : 0;
+}
+
+// the data of a writeback reaches the level below right away, so only its timing is modeled here.
+// without a write buffer the miss waits out the whole write; with one it waits only while the
+// buffer is full, and a block still queued takes the new write as well
+uint32_t Cache::bufferWriteback(uint32_t address, uint32_t cycle) {
+    if (writeBufferEntries == 0) {
+        writeBufferStats.stallCycles += writebackLatency;
+        return writebackLatency;
+    }
+
+    while (!writeBuffer.empty() && writeBuffer.front().doneCycle <= cycle) {
+        writeBuffer.pop_front();
+    }
+    for (BufferedWrite &entry : writeBuffer) {
+        if (entry.address == address && entry.doneCycle - writebackLatency > cycle) {
+            writeBufferStats.merged++;
             return 0;
         }
     }
 
-    // WRITE MISS
-    int newBlock = cacheMiss(address, addrTag, addrIndex, blockOffset);
-    cacheData[addrIndex][newBlock][blockOffset] = (uint8_t) value;
-    metaDataBits[addrIndex][newBlock].dirty = 1;
-    metaDataBits[addrIndex][newBlock].cycleReady = cycle + missLatency;
-    return missLatency;
-}
-
-uint32_t Cache::cacheMiss(uint32_t address, uint32_t tag, uint32_t addrIndex, uint32_t blockOffset) {
-    // 1. replace appropriate block based on lru
-    // 2. check the dirty bit to see if we need to do write back)
-    // 3. execute write back
-    // 4. overwrite data in cache 
-    
-    uint32_t setBlock;
-    // compare each block in a set to see which one is LRU
-    if((metaDataBits[addrIndex][0].lru > metaDataBits[addrIndex][1].lru) || (cacheType == TWO_WAY_SET_ASSOC && !metaDataBits[addrIndex][1].valid)) {
-        setBlock = 1;
+    uint32_t stall = 0;
+    if (writeBuffer.size() == writeBufferEntries) {
+        stall = writeBuffer.front().doneCycle - cycle;
+        writeBuffer.pop_front();
+        writeBufferStats.fullStalls++;
+        writeBufferStats.stallCycles += stall;
+    }
+    // entries drain one at a time, each starting once the one ahead of it is done
+    uint32_t start = cycle + stall;
+    if (!writeBuffer.empty()) start = std::max(start, writeBuffer.back().doneCycle);
+    writeBuffer.push_back(BufferedWrite{address, start + writebackLatency});
+    writeBufferStats.buffered++;
+    return stall;
+}
+
+// reads from the next cache level, or main memory at the bottom. returns the extra delay
+uint32_t Cache::readBelow(uint32_t address, uint8_t *data, uint32_t size, uint32_t cycle, bool &dirty) {
+    if (nextLevel) {
+        return nextLevel->fetchBlock(address, data, size, cycle, dirty);
+    }
+    if (flatMem) flatMem->getMemBlock(address, data, size);
+    else getMemBlock(mainMem, address, data, size);
+    return 0;
+}
+
+void Cache::writeBelow(uint32_t address, const uint8_t *data, uint32_t size) {
+    writebacks++;
+    if (nextLevel) {
+        nextLevel->writebackBlock(address, data, size, true);
     } else {
-        setBlock = 0;
+        if (flatMem) flatMem->setMemBlock(address, data, size);
+        else setMemBlock(mainMem, address, data, size);
     }
+}
+
+void Cache::setNextLevel(Cache *lower) {
+    nextLevel = lower;
+    lower->upperLevels.push_back(this);
+}
+
+// a miss from the level above. the range may cover several of this level's blocks, and the
+// slowest one decides the delay. an exclusive level hands its copy up instead of keeping it,
+// and misses go straight past it
+uint32_t Cache::fetchBlock(uint32_t address, uint8_t *data, uint32_t size, uint32_t cycle, bool &dirty) {
+    uint32_t delay = 0;
+    for (uint32_t done = 0; done < size; ) {
+        uint32_t addr = address + done;
+        uint32_t chunk = std::min(size - done, blockSize - (addr & offsetMask));
+        uint32_t addrTag = addressTag(addr);
+        uint32_t addrIndex = addressIndex(addr);
+        metaData *meta = setMeta(addrIndex);
+        uint32_t chunkDelay;
 
-    // check if dirty, if so then write-back
-    if (metaDataBits[addrIndex][setBlock].dirty) {
-        uint32_t memAddr = (metaDataBits[addrIndex][setBlock].tag << tagStart) | (addrIndex << indexStart);
-        // is this correct?????
-        // loop by each byte and set memory based on whats written in cache data 
-        for(uint32_t byteOffset = 0; byteOffset < blockSize; byteOffset++){
-            mainMem->setMemValue(memAddr + byteOffset, (uint32_t) cacheData[addrIndex][setBlock][byteOffset], BYTE_SIZE);
+        int way = findBlock(addrIndex, addrTag);
+        if (way >= 0) {
+            hits++;
+            // a block still being filled for an earlier request delays this one too
+            chunkDelay = meta[way].cycleReady > cycle ? meta[way].cycleReady - cycle : 0;
+            memcpy(data + done, blockData(addrIndex, way) + (addr & offsetMask), chunk);
+            if (inclusion == EXCLUSIVE) {
+                dirty |= meta[way].dirty;
+                meta[way].valid = 0;
+                meta[way].dirty = 0;
+                setTags(addrIndex)[way] = INVALID_TAG;
+            } else {
+                replacement->touch(addrIndex, way);
+            }
+        } else {
+            misses++;
+            if (inclusion == EXCLUSIVE) {
+                chunkDelay = missLatency + readBelow(addr, data + done, chunk, cycle, dirty);
+            } else {
+                uint32_t filled = cacheMiss(addr, addrTag, addrIndex, chunkDelay, cycle);
+                meta[filled].cycleReady = cycle + chunkDelay;
+                memcpy(data + done, blockData(addrIndex, filled) + (addr & offsetMask), chunk);
+            }
         }
 
-        // mainMem->setMemValue(address, cacheData[addrIndex][setBlock][blockOffset], BYTE_SIZE);
+        delay = std::max(delay, chunkDelay);
+        done += chunk;
+    }
+    return delay;
+}
+
+// a block evicted from the level above. an exclusive level allocates it, the others only update
+// blocks they already hold and pass the rest down
+void Cache::writebackBlock(uint32_t address, const uint8_t *data, uint32_t size, bool dirty) {
+    for (uint32_t done = 0; done < size; ) {
+        uint32_t addr = address + done;
+        uint32_t chunk = std::min(size - done, blockSize - (addr & offsetMask));
+        uint32_t addrTag = addressTag(addr);
+        uint32_t addrIndex = addressIndex(addr);
+        metaData *meta = setMeta(addrIndex);
+
+        int way = findBlock(addrIndex, addrTag);
+        // only a whole block can be allocated without reading it first. partial ones are
+        // writebacks passed down from further up, and go further down as well
+        if (way < 0 && inclusion == EXCLUSIVE && chunk == blockSize) {
+            // levels below L1 have no victim cache or write buffer, so nothing stalls here
+            uint32_t stall;
+            way = allocateBlock(addrIndex, 0, stall);
+            meta[way].valid = 1;
+            meta[way].dirty = 0;
+            meta[way].prefetched = 0;
+            meta[way].cycleReady = 0;
+            setTags(addrIndex)[way] = addrTag;
+            replacement->fill(addrIndex, way);
+        }
+
+        if (way >= 0) {
+            memcpy(blockData(addrIndex, way) + (addr & offsetMask), data + done, chunk);
+            meta[way].dirty |= dirty;
+        } else if (dirty) {
+            writeBelow(addr, data + done, chunk);
+        }
+        done += chunk;
     }
-  
-    uint32_t blockStartMemAddr = (address >> offsetEnd) << offsetEnd; // removing byte offset from address
-    // loop by each byte read from memory and write it into cache to over write data
-     for (uint32_t byteOffset = 0; byteOffset < blockSize; byteOffset++) {
-        uint32_t temp;
-        mainMem->getMemValue(blockStartMemAddr + byteOffset, temp, BYTE_SIZE);
-        cacheData[addrIndex][setBlock][byteOffset] = (uint8_t) temp;
-    }
-    // cacheData[addrIndex][setBlock][blockOffset] = mainMem->getMemValue(address, value, BYTE_SIZE);
-    metaDataBits[addrIndex][setBlock].dirty = 0;
-    metaDataBits[addrIndex][setBlock].valid = 1;
-    updateLRU(addrIndex, setBlock);
-    metaDataBits[addrIndex][setBlock].tag = tag;
-    return setBlock;
-    
 }
 
-void Cache::updateLRU(int addrIndex, int recentlyUsed){
-    for(uint32_t i = 0; i < assoc; i++) {
-        if(metaDataBits[addrIndex][recentlyUsed].lru > metaDataBits[addrIndex][recentlyUsed].lru) {
-            metaDataBits[addrIndex][i].lru -= 1;
+// back-invalidation from an inclusive level below. data holds that level's copy of the range;
+// any dirty block here is newer, so it is copied over it and dirty is set
+void Cache::invalidateBlocks(uint32_t address, uint8_t *data, uint32_t size, bool &dirty) {
+    for (uint32_t done = 0; done < size; ) {
+        uint32_t addr = address + done;
+        uint32_t chunk = std::min(size - done, blockSize - (addr & offsetMask));
+        uint32_t addrIndex = addressIndex(addr);
+        metaData *meta = setMeta(addrIndex);
+
+        int way = findBlock(addrIndex, addressTag(addr));
+        if (way >= 0) {
+            if (meta[way].dirty) {
+                memcpy(data + done, blockData(addrIndex, way) + (addr & offsetMask), chunk);
+                dirty = true;
+            }
+            meta[way].valid = 0;
+            meta[way].dirty = 0;
+            setTags(addrIndex)[way] = INVALID_TAG;
+        }
+        done += chunk;
+    }
+
+    // so may blocks in the victim cache
+    for (uint32_t i = 0; i < victimBlocks; i++) {
+        if (victimMeta[i].valid && victimTags[i] - address < size) {
+            if (victimMeta[i].dirty) {
+                memcpy(data + (victimTags[i] - address), victimBlock(i), blockSize);
+                dirty = true;
+            }
+            victimMeta[i].valid = 0;
+            victimMeta[i].dirty = 0;
+            victimTags[i] = INVALID_TAG;
         }
     }
-    metaDataBits[addrIndex][recentlyUsed].lru = assoc - 1; 
+
+    // the caches above this one may hold even newer data
+    for (Cache *upper : upperLevels) {
+        upper->invalidateBlocks(address, data, size, dirty);
+    }
 }
 
+// the pipeline replays every blocking access that missed once its block has been filled. that replay
+// hits, but it is the same access, so it is taken back out here instead of being counted again
 uint32_t Cache::getHits() {
-    return hits;
+    return hits - replays;
 }
 
 uint32_t Cache::getMisses() {
     return misses;
 }
 
+void Cache::clearStats() {
+    hits = 0;
+    misses = 0;
+    writebacks = 0;
+    replays = 0;
+    replayPending = false;
+    mshrStats = MshrStats{};
+    prefetchStats = PrefetchStats{};
+    victimStats = VictimCacheStats{};
+    writeBufferStats = WriteBufferStats{};
+}
+
+void Cache::settleBlocks() {
+    for (metaData &meta : metaDataBits) {
+        meta.cycleReady = 0;
+    }
+}
+
+// raw counts, for a level the pipeline does not access (and so does not replay) directly
+CacheLevelStats Cache::getLevelStats() {
+    return CacheLevelStats{hits, misses, writebacks};
+}
+
+// writeback to the level below all cache blocks that have a set valid/dirty bit. drain the
+// caches above a level before the level itself so their data reaches memory
 void Cache::drain() {
     for (uint32_t setNum = 0; setNum < numSets; setNum++) {
         for(uint32_t i = 0; i< assoc; i++){
-            if (metaDataBits[setNum][i].valid && metaDataBits[setNum][i].dirty) {
-                uint32_t memAddr = (metaDataBits[setNum][i].tag << tagStart) | (setNum << indexStart);
-                for (uint32_t byte_offset = 0; byte_offset < blockSize; byte_offset++) {
-                    mainMem->setMemValue(memAddr + byte_offset, (uint32_t) cacheData[setNum][i][byte_offset], BYTE_SIZE);
-                }   
+            metaData &block = setMeta(setNum)[i];
+            if (block.valid && block.dirty) {
+                writeBelow(blockAddress(setNum, i), blockData(setNum, i), blockSize);
+                block.dirty = 0;
             }
         }
     }
+    for (uint32_t i = 0; i < victimBlocks; i++) {
+        if (victimMeta[i].valid && victimMeta[i].dirty) {
+            writeBelow(victimTags[i], victimBlock(i), blockSize);
+            victimMeta[i].dirty = 0;
+        }
+    }
+}
+
+// what a checkpoint holds ahead of the metadata, tags, data and replacement state
+struct CacheCheckpoint {
+    uint32_t hits, misses, writebacks, replays;
+    uint32_t replayAddress;
+    uint32_t replayPending;
+};
+
+bool Cache::canCheckpoint() {
+    return mshrReady.empty() && !prefetcher && !victimBlocks && !writeBufferEntries && !writebackLatency &&
+           !nextLevel && upperLevels.empty();
+}
+
+uint32_t Cache::checkpointSize() {
+    return sizeof(CacheCheckpoint) + metaDataBits.size() * sizeof(metaData) + tagBits.size() * sizeof(uint32_t) +
+           cacheData.size() + replacement->stateSize();
+}
+
+// the arrays are copied as they are, so a restore is a few memcpys into a cache built from the same config
+void Cache::saveCheckpoint(uint8_t *state) {
+    CacheCheckpoint counts{hits, misses, writebacks, replays, replayAddress, replayPending};
+    memcpy(state, &counts, sizeof(counts));
+    state += sizeof(counts);
+    memcpy(state, metaDataBits.data(), metaDataBits.size() * sizeof(metaData));
+    state += metaDataBits.size() * sizeof(metaData);
+    memcpy(state, tagBits.data(), tagBits.size() * sizeof(uint32_t));
+    state += tagBits.size() * sizeof(uint32_t);
+    memcpy(state, cacheData.data(), cacheData.size());
+    state += cacheData.size();
+    replacement->saveState(state);
+}
+
+void Cache::loadCheckpoint(const uint8_t *state) {
+    CacheCheckpoint counts;
+    memcpy(&counts, state, sizeof(counts));
+    state += sizeof(counts);
+    hits = counts.hits;
+    misses = counts.misses;
+    writebacks = counts.writebacks;
+    replays = counts.replays;
+    replayAddress = counts.replayAddress;
+    replayPending = counts.replayPending;
+    memcpy(metaDataBits.data(), state, metaDataBits.size() * sizeof(metaData));
+    state += metaDataBits.size() * sizeof(metaData);
+    memcpy(tagBits.data(), state, tagBits.size() * sizeof(uint32_t));
+    state += tagBits.size() * sizeof(uint32_t);
+    memcpy(cacheData.data(), state, cacheData.size());
+    state += cacheData.size();
+    replacement->loadState(state);
 }
 
 Cache::~Cache(){
+    delete replacement;
+    delete prefetcher;
+    delete victimReplacement;
     metaDataBits.clear();
+    tagBits.clear();
     cacheData.clear();   
 }
-
-// Cache *createCache(CacheConfig config, MemoryStore *mem) {
-//     return new Cache(config, mem);
-// }
-
-// void deleteCache(Cache *cache) {
-//     delete cache;
-// }
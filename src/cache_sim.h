@@ -1,49 +1,163 @@
 #include <vector>
+#include <unordered_set>
+#include <deque>
+#include <string.h>
 
 using std::vector;
+using std::unordered_set;
+using std::deque;
 
+class ReplacementPolicy;
+class Prefetcher;
+class StackDistanceProfiler;
+class FlatMemoryStore;
 
 struct metaData {
     bool valid;
-    bool dirty; 
-    uint32_t tag;
-    uint32_t lru;
+    bool dirty;
+    // brought in by the prefetcher and not used yet
+    bool prefetched;
     uint32_t cycleReady;
 };
 
 class Cache {
     private:
-        //vector<uint32_t> tags;
-        //vector<uint32_t> valid;
-        // cacheBlock is uint8_t array
-        // index is brings us to right block and block offset brings us to the right byte 
-        vector<vector<vector<uint8_t>>> cacheData;
-        // metadata unique block, struct of tag, valid , dirty bits
-        // dimensions of 2d array is numSet x 2 blocks for 2 way
-        // dimensions fof 2d array is just index and 1 block for direct map
-        vector<vector<metaData>> metaDataBits;
+        // stores cache data for every block in one contiguous, set-major arena:
+        // block (set, way) starts at ((set * assoc) + way) * blockSize
+        vector<uint8_t> cacheData;
+        // metadata for each cache block, laid out set-major like cacheData: entry (set, way) is at set * assoc + way
+        vector<metaData> metaDataBits;
+        // tags kept apart from the rest of the metadata, same layout, so a lookup in a
+        // wide set only scans a packed uint32_t array. empty blocks hold INVALID_TAG
+        vector<uint32_t> tagBits;
         uint32_t hits;
         uint32_t misses;
-        uint32_t address;
+        uint32_t writebacks;
+        // misses the pipeline will replay, see getHits
+        uint32_t replays;
         CacheType cacheType;
-        // write back cache 
-        // dirty bit set everytime write into cache line 
-        // if dirty bit is set + valid bit, throw out block and update block in memory 
-        uint8_t lru;
         uint32_t numBlocks, numSets, blockSize, cacheSize, missLatency, assoc;
-        int offsetStart, offsetEnd, indexStart, indexEnd, tagStart, tagEnd;
-        // funcitons to set valid bit, lru, dirty, 
-        int setCacheByte(uint32_t address, uint32_t value, uint32_t cycle);
-        int getCacheByte(uint32_t address, uint32_t & value, uint32_t cycle);
-        void updateLRU(int addrIndex, int recentlyUsed);
+        int offsetEnd;
+        uint32_t offsetMask, indexMask;
+        bool setsPowerOfTwo;
+        // a block is tagged with its whole block number and goes in the set its remainder picks, so
+        // the sets need not be a power of two, as with 3 ways. a mask picks it when they are
+        uint32_t addressTag(uint32_t address) { return address >> offsetEnd; }
+        uint32_t addressIndex(uint32_t address) {
+            uint32_t block = address >> offsetEnd;
+            return setsPowerOfTwo ? block & indexMask : block % numSets;
+        }
+        int access(uint32_t address, uint8_t *bytes, uint32_t size, bool write, uint32_t cycle, uint32_t pc);
+        int accessBlock(uint32_t address, uint8_t *bytes, uint32_t size, bool write, uint32_t cycle);
+        int accessNonBlocking(uint32_t address, uint8_t *bytes, uint32_t size, bool write, uint32_t cycle, uint32_t &readyCycle, uint32_t pc);
+        // non-blocking mode only: the cycle each MSHR frees up, free once that cycle is reached
+        vector<uint32_t> mshrReady;
+        uint32_t mshrCoveredUntil;
+        MshrStats mshrStats;
+        Prefetcher *prefetcher;
+        PrefetchStats prefetchStats;
+        vector<uint32_t> prefetchCandidates;
+        // blocks evicted to make room for a prefetch, until they are asked for or brought back
+        unordered_set<uint32_t> prefetchVictims;
+        bool prefetching;
+        // set by accessBlock when an access should trigger the prefetcher
+        bool prefetchTrigger;
+        // the blocking access the pipeline will replay next, which the prefetcher has already seen
+        uint32_t replayAddress;
+        bool replayPending;
+        // sees every demand access once, replays left out, see setProfiler
+        StackDistanceProfiler *profiler;
+        void notePrefetchUse(metaData &meta, uint32_t cycle);
+        void notePrefetchMiss(uint32_t address);
+        void issuePrefetches(uint32_t address, uint32_t pc, uint32_t cycle);
+        // victim cache: victimBlocks fully associative blocks, tagged with their whole block address
+        uint32_t victimBlocks;
+        vector<metaData> victimMeta;
+        vector<uint32_t> victimTags;
+        vector<uint8_t> victimData;
+        ReplacementPolicy *victimReplacement;
+        VictimCacheStats victimStats;
+        // a block on its way from the victim cache back into the cache proper
+        vector<uint8_t> swapBlock;
+        // write buffer: the writebacks still draining, oldest first, and the cycle each one is done
+        struct BufferedWrite {
+            uint32_t address;
+            uint32_t doneCycle;
+        };
+        deque<BufferedWrite> writeBuffer;
+        uint32_t writeBufferEntries, writebackLatency;
+        WriteBufferStats writeBufferStats;
+        uint8_t *victimBlock(uint32_t slot) { return &victimData[slot * blockSize]; }
+        int findVictim(uint32_t address);
+        uint32_t spillVictim(uint32_t address, const uint8_t *data, bool dirty, uint32_t cycle);
+        uint32_t retireBlock(uint32_t address, uint8_t *data, bool dirty, uint32_t cycle);
+        uint32_t bufferWriteback(uint32_t address, uint32_t cycle);
+        uint32_t cacheMiss(uint32_t address, uint32_t tag, uint32_t addrIndex, uint32_t &delay, uint32_t cycle);
+        int findBlock(uint32_t addrIndex, uint32_t tag);
+        uint32_t allocateBlock(uint32_t addrIndex, uint32_t cycle, uint32_t &stall);
+        uint32_t evictBlock(uint32_t addrIndex, uint32_t way, uint32_t cycle);
+        uint32_t readBelow(uint32_t address, uint8_t *data, uint32_t size, uint32_t cycle, bool &dirty);
+        void writeBelow(uint32_t address, const uint8_t *data, uint32_t size);
+        uint32_t blockAddress(uint32_t addrIndex, uint32_t way) { return setTags(addrIndex)[way] << offsetEnd; }
+        ReplacementPolicy *replacement;
+        InclusionPolicy inclusion;
+        // the cache misses and writebacks go to, or nullptr when that is mainMem
+        Cache *nextLevel;
+        // caches that use this one as their nextLevel
+        vector<Cache *> upperLevels;
+        // first metadata entry / tag / data byte of a set
+        metaData *setMeta(uint32_t addrIndex) { return &metaDataBits[addrIndex * assoc]; }
+        uint32_t *setTags(uint32_t addrIndex) { return &tagBits[addrIndex * assoc]; }
+        uint8_t *blockData(uint32_t addrIndex, uint32_t way) { return &cacheData[(addrIndex * assoc + way) * blockSize]; }
+        static void copyBytes(uint8_t *block, uint8_t *bytes, uint32_t size, bool write) {
+            if (write) memcpy(block, bytes, size);
+            else memcpy(bytes, block, size);
+        }
         MemoryStore *mainMem;
+        // mainMem, when it is a FlatMemoryStore, so block moves skip the virtual calls
+        FlatMemoryStore *flatMem;
     public:
         Cache(CacheConfig &cache, MemoryStore *mem);
-        int getCacheValue(uint32_t address, uint32_t & value, MemEntrySize size, uint32_t cycle);
-        int setCacheValue(uint32_t address, uint32_t value, MemEntrySize size, uint32_t cycle);
+        // pc is the instruction making the access, for the prefetcher
+        int getCacheValue(uint32_t address, uint32_t & value, MemEntrySize size, uint32_t cycle, uint32_t pc = 0);
+        int setCacheValue(uint32_t address, uint32_t value, MemEntrySize size, uint32_t cycle, uint32_t pc = 0);
+        // lockup-free versions, for a cache configured with MSHRs. the access completes now and
+        // readyCycle is when its data really arrives; nonzero means wait that long for a free MSHR
+        int getCacheValue(uint32_t address, uint32_t & value, MemEntrySize size, uint32_t cycle, uint32_t &readyCycle, uint32_t pc);
+        int setCacheValue(uint32_t address, uint32_t value, MemEntrySize size, uint32_t cycle, uint32_t &readyCycle, uint32_t pc);
+        bool isNonBlocking() { return !mshrReady.empty(); }
+        MshrStats getMshrStats() { return mshrStats; }
+        bool hasPrefetcher() { return prefetcher != nullptr; }
+        PrefetchStats getPrefetchStats() { return prefetchStats; }
+        bool hasVictimCache() { return victimBlocks != 0; }
+        VictimCacheStats getVictimStats() { return victimStats; }
+        bool hasWriteBuffer() { return writeBufferEntries != 0; }
+        // also hands each demand access to profiler, which must outlive the cache. nullptr stops
+        void setProfiler(StackDistanceProfiler *stackProfiler) { profiler = stackProfiler; }
+        WriteBufferStats getWriteBufferStats() { return writeBufferStats; }
         uint32_t getHits();
         uint32_t getMisses();
-        uint32_t cacheMiss(uint32_t address, uint32_t tag, uint32_t addrIndex, uint32_t blockOffset);
+        // zeroes the counts, leaving the blocks as they are, so a warmed cache counts from here on
+        void clearStats();
+        // marks every block as arrived, for blocks filled on a clock other than the pipeline's
+        void settleBlocks();
+        CacheLevelStats getLevelStats();
         void drain();
+        // checkpoints hold the cache proper: its blocks, their metadata, the replacement state and the
+        // counts, in checkpointSize() bytes. loadCheckpoint takes them back into a cache built from the
+        // same config. a cache with MSHRs, a prefetcher, a victim cache, writeback timing or other
+        // levels around it has more state than that, and cannot be checkpointed
+        bool canCheckpoint();
+        uint32_t checkpointSize();
+        void saveCheckpoint(uint8_t *state);
+        void loadCheckpoint(const uint8_t *state);
+
+        // puts this cache in front of lower, which must outlive it
+        void setNextLevel(Cache *lower);
+        // used by the caches above: read a range of bytes (returning the extra delay), write back
+        // a range they evicted, and give up every block in a range, merging newer dirty data into data
+        uint32_t fetchBlock(uint32_t address, uint8_t *data, uint32_t size, uint32_t cycle, bool &dirty);
+        void writebackBlock(uint32_t address, const uint8_t *data, uint32_t size, bool dirty);
+        void invalidateBlocks(uint32_t address, uint8_t *data, uint32_t size, bool &dirty);
         ~Cache();
-};
\ No newline at end of file
+};
@@ -4,268 +4,23 @@
 #include <string.h>
 #include <algorithm>
 #include <vector>
+#include <string>
 #include <errno.h>
+#include <stdlib.h>
 #include <math.h> 
 #include "MemoryStore.h"
+#include "FlatMemoryStore.h"
+#include "SparseMemoryStore.h"
 #include "RegisterInfo.h"
+#include "TraceFile.h"
+#include "SnapshotFile.h"
 #include "EndianHelpers.h"
 #include "DriverFunctions.h"
+#include "cycle_sim.h"
 
-// CACHE
-
-#define ADDRESS_LEN 32 
-
-using std::vector;
-
-struct metaData {
-    bool valid;
-    bool dirty; 
-    uint32_t tag;
-    uint32_t lru;
-    uint32_t cycleReady;
-};
-
-class Cache {
-    private:
-        // stores cache data for each block accessed by index, assoc value, and block offset
-        vector<vector<vector<uint8_t>>> cacheData;
-        // metadata for each cache block accessed by index and set block number if applicable 
-        vector<vector<metaData>> metaDataBits;
-        uint32_t hits;
-        uint32_t misses;
-        CacheType cacheType;
-        uint32_t address, numBlocks, numSets, blockSize, cacheSize, missLatency, assoc;
-        int offsetStart, offsetEnd, indexStart, indexEnd, tagStart, tagEnd;
-        int setCacheByte(uint32_t address, uint32_t value, uint32_t cycle);
-        int getCacheByte(uint32_t address, uint32_t & value, uint32_t cycle);
-        uint32_t cacheMiss(uint32_t address, uint32_t tag, uint32_t addrIndex, uint32_t blockOffset);
-        void updateLRU(int addrIndex, int recentlyUsed);
-        MemoryStore *mainMem;
-    public:
-        Cache(CacheConfig &cache, MemoryStore *mem);
-        int getCacheValue(uint32_t address, uint32_t & value, MemEntrySize size, uint32_t cycle);
-        int setCacheValue(uint32_t address, uint32_t value, MemEntrySize size, uint32_t cycle);
-        uint32_t getHits();
-        uint32_t getMisses();
-        void drain();
-        ~Cache();
-};
-
-// initialize once for I cache and D cache
-Cache::Cache(CacheConfig &config, MemoryStore *mem) {
-    hits = 0;
-    misses = 0;
-    blockSize = config.blockSize;
-    cacheSize= config.cacheSize;
-    missLatency = config.missLatency;
-    cacheType = config.type;
-    mainMem = mem;
-    numBlocks = cacheSize/blockSize;
-    if(cacheType == TWO_WAY_SET_ASSOC) {
-        assoc = 2;
-    } else {
-        assoc = 1;
-    }
-    if(cacheType == TWO_WAY_SET_ASSOC) {
-        numSets = numBlocks/2;
-    } else {
-        numSets = numBlocks;
-    }
-    for (uint32_t i = 0; i < numSets; i++) {
-        metaDataBits.emplace_back();
-        for (uint32_t j = 0; j < assoc; j++) {
-            metaDataBits[i].emplace_back();
-        }
-    }
-
-    for (uint32_t i = 0; i < numSets; i++) {
-        cacheData.emplace_back();        
-        for (uint32_t j = 0; j < assoc; j++) {
-            cacheData[i].emplace_back();
-            for (uint32_t k = 0; k<blockSize; k++) {
-                cacheData[i][j].emplace_back();
-            }
-        }
-    }
-
-
-    offsetStart = 0;
-    offsetEnd   = log2(blockSize);
-    indexStart  = log2(blockSize);
-    indexEnd    = indexStart + log2(numSets);
-    tagStart    = indexStart + log2(numSets);
-    tagEnd      = ADDRESS_LEN;
-    
-}
-
- // address given is the address of the first byte
-int Cache::getCacheValue(uint32_t address, uint32_t & value, MemEntrySize size, uint32_t cycle){
-    int result;
-    value = 0;
-
-    // look at each byte  
-    for(uint32_t i = 0; i< size; i++){
-        uint32_t byteAddr = address+i;
-        uint32_t byte;
-        result = getCacheByte(byteAddr, byte, cycle);
-        if(i ==0){
-            if(result == 0) {
-                hits++;
-            } else {
-                misses++;
-                hits--;
-            }
-        }
-        value = value | (byte << ((size-1-i)*8));
-    }
-    return result;
-}
-
-    
-
-int Cache::setCacheValue(uint32_t address, uint32_t value, MemEntrySize size, uint32_t cycle) {
-    uint32_t mask = 0xFF;
-    int result;
-    for (uint32_t i = 0; i < size; i++) {
-        uint32_t byte = (value & (mask << ((size-1-i)*8))) >> ((size-1-i)*8);
-        result = setCacheByte(address + i, byte, cycle);
-        if(i ==0){
-            if(result == 0) {
-                hits++;
-            } else {
-                misses++;
-                hits--;
-            }
-        }
-    }
-    return result;
-}
-
-int Cache::getCacheByte(uint32_t address, uint32_t & value, uint32_t cycle){
-    uint32_t addressCopy = address;
-    uint32_t addrTag = addressCopy << (ADDRESS_LEN - tagEnd) >> (ADDRESS_LEN-tagEnd) >> (tagStart);
-    addressCopy = address;
-    uint32_t addrIndex = addressCopy << (ADDRESS_LEN - indexEnd) >> (ADDRESS_LEN - indexEnd) >> indexStart;
-    addressCopy = address;
-    uint32_t blockOffset = addressCopy << (ADDRESS_LEN - offsetEnd) >> (ADDRESS_LEN - offsetEnd) >> offsetStart;
-
-        // iterate through each block in a set
-       for (uint32_t i = 0; i< assoc; i++) {
-        // read Hit
-        if(metaDataBits[addrIndex][i].valid  && metaDataBits[addrIndex][i].tag == addrTag) {
-            if (metaDataBits[addrIndex][i].cycleReady > cycle) return missLatency;
-            value = cacheData[addrIndex][i][blockOffset];
-            updateLRU(addrIndex, i);
-            return 0;
-        } 
-    }
-    // gets data from memory after a cache miss 
-    uint32_t newBlock = cacheMiss(addressCopy, addrTag, addrIndex, blockOffset);
-    value = cacheData[addrIndex][newBlock][blockOffset];
-    metaDataBits[addrIndex][newBlock].cycleReady = cycle + missLatency;
-    return missLatency;
-}
-
-int Cache::setCacheByte(uint32_t address, uint32_t value, uint32_t cycle) {
-    uint32_t addressCopy = address;
-    uint32_t addrTag = (ADDRESS_LEN - tagEnd) >> (ADDRESS_LEN-tagEnd) >> (tagStart);
-    addressCopy = address;
-    uint32_t addrIndex = (addressCopy << (ADDRESS_LEN - indexEnd)) >> (ADDRESS_LEN - indexEnd) >> indexStart;
-    addressCopy = address;
-    uint32_t blockOffset = addressCopy << (ADDRESS_LEN - offsetEnd) >> (ADDRESS_LEN - offsetEnd) >> offsetStart;
-
-    // loop through blocks in the set, starting at startBlock
-    for (uint32_t i = 0; i < assoc; i++) {
-        // WRITE HIT
-        if (metaDataBits[addrIndex][i].valid  && metaDataBits[addrIndex][i].tag == addrTag) { 
-            if (metaDataBits[addrIndex][i].cycleReady > cycle) {
-                return missLatency; // we've hit before, but are emulating latency 
-            }
-            cacheData[addrIndex][i][blockOffset] = (uint8_t) value;
-            metaDataBits[addrIndex][i].dirty = 1;
-            updateLRU(addrIndex, i);
-            return 0;
-        }
-    }
-
-    // WRITE MISS
-    uint32_t newBlock = cacheMiss(address, addrTag, addrIndex, blockOffset);
-    cacheData[addrIndex][newBlock][blockOffset] = (uint8_t) value;
-    metaDataBits[addrIndex][newBlock].dirty = 1;
-    metaDataBits[addrIndex][newBlock].cycleReady = cycle + missLatency;
-    return missLatency;
-}
-
-uint32_t Cache::cacheMiss(uint32_t address, uint32_t tag, uint32_t addrIndex, uint32_t blockOffset) { 
-    uint32_t setBlock;
-    // compare each block in a set to see which one is LRU
-    if((metaDataBits[addrIndex][0].lru > metaDataBits[addrIndex][1].lru) || (cacheType == TWO_WAY_SET_ASSOC && !metaDataBits[addrIndex][1].valid)) {
-        setBlock = 1;
-    } else {
-        setBlock = 0;
-    }
-
-    // check if dirty, if so then write-back
-    if (metaDataBits[addrIndex][setBlock].dirty) {
-        uint32_t memAddr = (metaDataBits[addrIndex][setBlock].tag << tagStart) | (addrIndex << indexStart);
-        for(uint32_t byteOffset = 0; byteOffset < blockSize; byteOffset++){
-            mainMem->setMemValue(memAddr + byteOffset, (uint32_t) cacheData[addrIndex][setBlock][byteOffset], BYTE_SIZE);
-        }
-    }
-    
-    uint32_t blockStartMemAddr = (address >> offsetEnd) << offsetEnd; // removing byte offset from address
-
-    // loop by each byte read from memory and write it into cache to over write data
-     for (uint32_t byteOffset = 0; byteOffset < blockSize; byteOffset++) {
-        uint32_t temp;
-        mainMem->getMemValue(blockStartMemAddr + byteOffset, temp, BYTE_SIZE);
-        cacheData[addrIndex][setBlock][byteOffset] = (uint8_t) temp;
-    }
-    
-    metaDataBits[addrIndex][setBlock].dirty = 0;
-    metaDataBits[addrIndex][setBlock].valid = 1;
-    updateLRU(addrIndex, setBlock);
-    metaDataBits[addrIndex][setBlock].tag = tag;
-    return setBlock;
-    
-}
-
-// for a 2 way set, updates most recently used cache block as a one and least recently used as zero
-void Cache::updateLRU(int addrIndex, int recentlyUsed){
-    for(uint32_t i = 0; i < assoc; i++) {
-        if(metaDataBits[addrIndex][i].lru > metaDataBits[addrIndex][recentlyUsed].lru) {
-            metaDataBits[addrIndex][i].lru -= 1;
-        }
-    }
-    metaDataBits[addrIndex][recentlyUsed].lru = assoc - 1; 
-}
-
-uint32_t Cache::getHits() {
-    return hits;
-}
-
-uint32_t Cache::getMisses() {
-    return misses;
-}
-
-// writeback to memory all cache blocks that have a set valid/dirty bit
-void Cache::drain() {
-    for (uint32_t setNum = 0; setNum < numSets; setNum++) {
-        for(uint32_t i = 0; i< assoc; i++){
-            if (metaDataBits[setNum][i].valid && metaDataBits[setNum][i].dirty) {
-                uint32_t memAddr = (metaDataBits[setNum][i].tag << tagStart) | (setNum << indexStart);
-                for (uint32_t byte_offset = 0; byte_offset < blockSize; byte_offset++) {
-                    mainMem->setMemValue(memAddr + byte_offset, (uint32_t) cacheData[setNum][i][byte_offset], BYTE_SIZE);
-                }   
-            }
-        }
-    }
-}
-
-Cache::~Cache(){
-    metaDataBits.clear();
-    cacheData.clear();   
-}
+#include "cache_sim.h"
+#include "branch_predictor.h"
+#include "stack_distance.h"
 
 // SIMULATOR
 
@@ -355,52 +110,6 @@ enum FUN_IDS
     FUN_SUBU = 0x23
 };
 
-//Static global variables...
-static uint32_t regs[NUM_REGS];
-
-
-void fillRegisterState(RegisterInfo &reg)
-{
-    reg.at = regs[REG_AT];
-
-    for (int i = 0; i < V_REG_SIZE; i++)
-    {
-        reg.v[i] = regs[i + REG_V0];
-    }
-
-    for (int i = 0; i < A_REG_SIZE; i++)
-    {
-        reg.a[i] = regs[i + REG_A0];
-    }
-
-    //Remember, t8 and t9 are handled separately...
-    for (int i = 0; i < T_REG_SIZE - 2; i++)
-    {
-        reg.t[i] = regs[i + REG_T0];
-    }
-
-    for (int i = 0; i < S_REG_SIZE; i++)
-    {
-        reg.s[i] = regs[i + REG_S0];
-    }
-
-    //t8 and t9...
-    for (int i = 0; i < 2; i++)
-    {
-        reg.t[i + 8] = regs[i + REG_T8];
-    }
-
-    for (int i = 0; i < K_REG_SIZE; i++)
-    {
-        reg.k[i] = regs[i + REG_K0];
-    }
-
-    reg.gp = regs[REG_GP];
-    reg.sp = regs[REG_SP];
-    reg.fp = regs[REG_FP];
-    reg.ra = regs[REG_RA];
-}
-
 enum INST_TYPE
 {
     R,
@@ -526,20 +235,161 @@ struct IFID
 {
     uint32_t pc;
     uint32_t instruction;
+    // set for an instruction really fetched, clear for a bubble or a squashed slot
+    bool valid = false;
 };
 
 struct IDEX
 {
+    uint32_t pc;
     uint32_t instruction;
+    bool valid = false;
     InstructionData instructionData;
     uint64_t regWriteValue = UINT64_MAX;
     uint8_t regToWrite;
+    // with a branch predictor: the direction it gave a conditional branch, and whether the
+    // branch left decode on the predicted pc before its operands were ready
+    bool predictedTaken = false;
+    bool speculative = false;
+    uint32_t predictedPc;
 };
 
 using EXMEM = IDEX;
 
 using MEMWB = EXMEM;
 
+enum CycleStatus
+{
+    NOT_HALTED,
+    HALTED,
+    // an instruction the pipeline cannot execute reached EX; the simulator runs no further
+    FAULTED
+};
+
+// everything one simulated machine holds. the pipeline below only works on these members, so
+// simulators do not share any state
+struct Simulator::Machine
+{
+    uint32_t regs[NUM_REGS] = {};
+    // with a non-blocking D-cache, the cycle each register's pending load data arrives
+    uint32_t regReadyCycle[NUM_REGS] = {};
+    Cache *icache = nullptr;
+    Cache *dcache = nullptr;
+    // shared levels between the L1 caches and memory, L2 first
+    vector<Cache *> lowerCaches;
+    // all nullptr unless initBranchPredictor set up a predictor
+    BranchPredictor *branchPredictor = nullptr;
+    BranchTargetBuffer *branchTargets = nullptr;
+    ReturnAddressStack *returnStack = nullptr;
+    BranchStats branchStats{};
+    // both nullptr unless initCacheAnalysis set up profiling
+    StackDistanceProfiler *icacheProfile = nullptr;
+    StackDistanceProfiler *dcacheProfile = nullptr;
+    CacheAnalysisConfig analysisConfig;
+    PipeState pipeState{};
+    uint32_t pc = 0;
+    MemoryStore *memStore = nullptr;
+    IFID ifid{};
+    IDEX idex{};
+    EXMEM exmem{};
+    MEMWB memwb{};
+    bool haltSeen = false;
+    int fetchHaltCycles = 0;
+    int memHaltCycles = 0;
+    uint32_t lastPcFetch = UINT32_MAX;
+    uint32_t lastInstructionFetch = 0;
+    CycleStatus cycleStatus{};
+    SimulationStats simStats{};
+    // instructions that have left writeback, squashed ones and bubbles left out
+    uint64_t retiredInstructions = 0;
+    // where finalize writes its reports; empty for the working directory, through the prebuilt dumps
+    string reportDirectory;
+    // nullptr unless initTrace started a trace. an access straight after the same one missed is
+    // the pipeline replaying it, and is left out of the trace as the caches leave it out of their
+    // counts. index 0 is the fetch stream, 1 the data stream
+    TraceWriter *trace = nullptr;
+    bool tracePending[2] = {};
+    uint32_t tracePendingAddress[2] = {};
+    // what the L1 caches were built from, for checkpoints
+    CacheConfig icacheConfig{};
+    CacheConfig dcacheConfig{};
+
+    int init(CacheConfig &icConfig, CacheConfig &dcConfig, CacheConfig *lowerConfigs,
+             uint32_t numLevels, MemoryStore *mainMem);
+    int initBranchPredictor(BranchPredictorConfig &bpConfig);
+    int initCacheAnalysis(CacheAnalysisConfig &config);
+    int initTrace(const char *fileName);
+    void traceAccess(TraceKind kind, uint32_t address, uint32_t size, int delay);
+    void traceMem(EXMEM &exmem, int delay);
+    void fillRegisterState(RegisterInfo &reg);
+    struct RData getRData(uint32_t instr);
+    struct IData getIData(uint32_t instr);
+    bool handleRInstEx(RData &rData, uint64_t &rdValue);
+    int handleMemNonBlocking(EXMEM &exmem, uint32_t addr);
+    int handleMem(EXMEM &exmem);
+    bool predictJumpTarget(uint32_t jumpPc, uint8_t rs, uint32_t &target);
+    bool resolveBranch(IDEX &branch, uint32_t &resolvedPc);
+    bool registerPending(InstructionData &instr);
+    CycleStatus runCycle();
+    uint32_t skipStalledCycles(uint32_t limit);
+    int runCycles(uint32_t cycles);
+    int runTillHalt();
+    int runInstructions(uint64_t instructions);
+    SimulationStats getStats();
+    void printBranchStats(ofstream &statsFile);
+    void printExtraSimStats();
+    void printCacheCurve(ofstream &curveFile, const string &name, StackDistanceProfiler *profile);
+    void printCacheAnalysis();
+    string reportPath(const char *name);
+    int finalize();
+    void release();
+    int checkpoint(const char *fileName);
+    int restore(const char *fileName, CacheConfig *icConfig, CacheConfig *dcConfig, MemoryStore *mainMem);
+    int warmCaches(const char *fileName);
+};
+
+void Simulator::Machine::fillRegisterState(RegisterInfo &reg)
+{
+    reg.at = regs[REG_AT];
+
+    for (int i = 0; i < V_REG_SIZE; i++)
+    {
+        reg.v[i] = regs[i + REG_V0];
+    }
+
+    for (int i = 0; i < A_REG_SIZE; i++)
+    {
+        reg.a[i] = regs[i + REG_A0];
+    }
+
+    //Remember, t8 and t9 are handled separately...
+    for (int i = 0; i < T_REG_SIZE - 2; i++)
+    {
+        reg.t[i] = regs[i + REG_T0];
+    }
+
+    for (int i = 0; i < S_REG_SIZE; i++)
+    {
+        reg.s[i] = regs[i + REG_S0];
+    }
+
+    //t8 and t9...
+    for (int i = 0; i < 2; i++)
+    {
+        reg.t[i + 8] = regs[i + REG_T8];
+    }
+
+    for (int i = 0; i < K_REG_SIZE; i++)
+    {
+        reg.k[i] = regs[i + REG_K0];
+    }
+
+    reg.gp = regs[REG_GP];
+    reg.sp = regs[REG_SP];
+    reg.fp = regs[REG_FP];
+    reg.ra = regs[REG_RA];
+}
+
 // get opcode from instruction
 uint8_t getOpcode(uint32_t instr)
 {
@@ -590,7 +440,7 @@ enum INST_TYPE getInstType(uint32_t instr)
 
 // Arg: current instruction
 // Return: struct RData holding relevant register instruction data
-struct RData getRData(uint32_t instr)
+struct RData Simulator::Machine::getRData(uint32_t instr)
 {
     if (instr == 0xfeedfeed)
         return RData{};
@@ -612,7 +462,7 @@ struct RData getRData(uint32_t instr)
 
 // Arg: current instruction
 // Return: struct IData holding relevant immmediate instruction data
-struct IData getIData(uint32_t instr)
+struct IData Simulator::Machine::getIData(uint32_t instr)
 {
     uint8_t rs = (instr >> 21) & 0x1f;
     uint8_t rt = (instr >> 16) & 0x1f;
@@ -644,33 +494,45 @@ struct JData getJData(uint32_t instr, uint32_t pc)
     return jData;
 }
 
-enum CycleStatus
+int Simulator::Machine::init(CacheConfig &icConfig, CacheConfig &dcConfig, CacheConfig *lowerConfigs,
+                             uint32_t numLevels, MemoryStore *mainMem)
 {
-    NOT_HALTED,
-    HALTED
-};
-
-Cache *icache;
-Cache *dcache;
-PipeState pipeState;
-uint32_t pc;
-MemoryStore *memStore;
-IFID ifid;
-IDEX idex;
-EXMEM exmem;
-MEMWB memwb;
-bool haltSeen;
-int fetchHaltCycles;
-int memHaltCycles;
-uint32_t lastPcFetch;
-uint32_t lastInstructionFetch;
-CycleStatus cycleStatus{};
-SimulationStats simStats{};
+    for (uint32_t i = 0; i < numLevels; i++)
+    {
+        // an inclusive level must cover whole blocks of the levels above, an exclusive one swaps them whole
+        uint32_t upperBlock = i == 0 ? std::max(icConfig.blockSize, dcConfig.blockSize) : lowerConfigs[i - 1].blockSize;
+        bool matches = i == 0 ? icConfig.blockSize == dcConfig.blockSize : true;
+        if ((lowerConfigs[i].inclusion == INCLUSIVE && lowerConfigs[i].blockSize < upperBlock) ||
+            (lowerConfigs[i].inclusion == EXCLUSIVE && (!matches || lowerConfigs[i].blockSize != upperBlock)))
+        {
+            cout << "Cache level L" << i + 2 << " block size does not fit its inclusion policy" << endl;
+            return -EINVAL;
+        }
+        if (lowerConfigs[i].victimBlocks || lowerConfigs[i].writeBufferEntries || lowerConfigs[i].writebackLatency)
+        {
+            cout << "Cache level L" << i + 2 << " cannot have a victim cache or write buffer" << endl;
+            return -EINVAL;
+        }
+    }
 
-int initSimulator(CacheConfig &icConfig, CacheConfig &dcConfig, MemoryStore *mainMem)
-{
+    release();
     icache = new Cache{icConfig, mainMem};
     dcache = new Cache{dcConfig, mainMem};
+    icacheConfig = icConfig;
+    dcacheConfig = dcConfig;
+    for (uint32_t i = 0; i < numLevels; i++)
+    {
+        lowerCaches.push_back(new Cache{lowerConfigs[i], mainMem});
+        if (i == 0)
+        {
+            icache->setNextLevel(lowerCaches[0]);
+            dcache->setNextLevel(lowerCaches[0]);
+        }
+        else
+        {
+            lowerCaches[i - 1]->setNextLevel(lowerCaches[i]);
+        }
+    }
 
     pipeState = PipeState{};
     pc = 0;
@@ -686,9 +548,101 @@ int initSimulator(CacheConfig &icConfig, CacheConfig &dcConfig, MemoryStore *mai
     lastInstructionFetch = 0;
     cycleStatus = CycleStatus{};
     simStats = SimulationStats{};
+    retiredInstructions = 0;
+    memset(regs, 0, sizeof(regs));
+    memset(regReadyCycle, 0, sizeof(regReadyCycle));
+    return 0;
+}
+
+int Simulator::Machine::initBranchPredictor(BranchPredictorConfig &bpConfig)
+{
+    delete branchPredictor;
+    delete branchTargets;
+    delete returnStack;
+    branchPredictor = createBranchPredictor(bpConfig.type, bpConfig.tableSize, bpConfig.historyBits);
+    branchTargets = branchPredictor ? new BranchTargetBuffer(bpConfig.btbEntries) : nullptr;
+    returnStack = branchPredictor ? new ReturnAddressStack(bpConfig.rasDepth) : nullptr;
+    branchStats = BranchStats{};
+    return 0;
+}
+
+static bool isPowerOfTwo(uint32_t value)
+{
+    return value && !(value & (value - 1));
+}
+
+int Simulator::Machine::initCacheAnalysis(CacheAnalysisConfig &config)
+{
+    if (!isPowerOfTwo(config.minCacheSize) || !isPowerOfTwo(config.maxCacheSize) ||
+        !isPowerOfTwo(config.minBlockSize) || !isPowerOfTwo(config.maxBlockSize) ||
+        !isPowerOfTwo(config.maxAssociativity) || config.minCacheSize > config.maxCacheSize ||
+        config.minBlockSize > config.maxBlockSize || config.maxBlockSize > config.maxCacheSize)
+    {
+        cout << "Cache analysis sizes must be powers of two, each minimum no larger than its maximum" << endl;
+        return -EINVAL;
+    }
+
+    delete icacheProfile;
+    delete dcacheProfile;
+    analysisConfig = config;
+    icacheProfile = new StackDistanceProfiler(config);
+    dcacheProfile = new StackDistanceProfiler(config);
+    icache->setProfiler(icacheProfile);
+    dcache->setProfiler(dcacheProfile);
+    return 0;
+}
+
+int Simulator::Machine::initTrace(const char *fileName)
+{
+    delete trace;
+    trace = new TraceWriter;
+    tracePending[0] = tracePending[1] = false;
+    if (int err = trace->open(fileName, TRACE_CYCLES))
+    {
+        delete trace;
+        trace = nullptr;
+        return err;
+    }
     return 0;
 }
 
+void Simulator::Machine::traceAccess(TraceKind kind, uint32_t address, uint32_t size, int delay)
+{
+    uint32_t stream = TraceCursor::stream(kind);
+    bool replay = tracePending[stream] && tracePendingAddress[stream] == address;
+    tracePending[stream] = delay != 0;
+    tracePendingAddress[stream] = address;
+    if (!replay) trace->record(kind, address, size, pipeState.cycle);
+}
+
+// the access handleMem just made for exmem, if any
+void Simulator::Machine::traceMem(EXMEM &exmem, int delay)
+{
+    IData &iData = exmem.instructionData.data.iData;
+    uint32_t addr = iData.rsValue + iData.seImm;
+    switch (iData.opcode)
+    {
+    case OP_SB:
+        traceAccess(TRACE_WRITE, addr, BYTE_SIZE, delay);
+        break;
+    case OP_SH:
+        traceAccess(TRACE_WRITE, addr, HALF_SIZE, delay);
+        break;
+    case OP_SW:
+        traceAccess(TRACE_WRITE, addr, WORD_SIZE, delay);
+        break;
+    case OP_LBU:
+        traceAccess(TRACE_READ, addr, BYTE_SIZE, delay);
+        break;
+    case OP_LHU:
+        traceAccess(TRACE_READ, addr, HALF_SIZE, delay);
+        break;
+    case OP_LW:
+        traceAccess(TRACE_READ, addr, WORD_SIZE, delay);
+        break;
+    }
+}
+
 uint8_t getSign(uint32_t value)
 {
     return (value >> 31) & 0x1;
@@ -735,7 +689,7 @@ bool doAddSub(uint32_t s1, uint32_t s2, bool isAdd, bool checkOverflow, uint64_t
 
 // sets rdValue to new value of rd, or UINT64_MAX if none
 // returns true if instruction caused exception, false otherwise
-bool handleRInstEx(RData &rData, uint64_t &rdValue)
+bool Simulator::Machine::handleRInstEx(RData &rData, uint64_t &rdValue)
 {
     switch (rData.funct)
     {
@@ -775,7 +729,7 @@ bool handleRInstEx(RData &rData, uint64_t &rdValue)
         cerr << "Illegal function code at address "
              << "0x" << hex
              << setfill('0') << setw(8) << pc - 4 << ": " << (uint16_t)rData.funct << endl;
-        exit(1);
+        cycleStatus = FAULTED;
         break;
     }
 
@@ -823,24 +777,69 @@ bool handleImmInstEx(IData &iData, uint64_t &rtValue)
     return false;
 }
 
+// with MSHRs, a load that misses still completes here; only the instructions that read its
+// register wait (see registerPending). a nonzero return is a stall for a free MSHR
+int Simulator::Machine::handleMemNonBlocking(EXMEM &exmem, uint32_t addr)
+{
+    IData &iData = exmem.instructionData.data.iData;
+    uint32_t data = 0;
+    uint32_t readyCycle = 0;
+    int delay = 0;
+
+    switch (iData.opcode)
+    {
+    case OP_SB:
+        return dcache->setCacheValue(addr, iData.rtValue, BYTE_SIZE, pipeState.cycle, readyCycle, exmem.pc);
+    case OP_SH:
+        return dcache->setCacheValue(addr, iData.rtValue, HALF_SIZE, pipeState.cycle, readyCycle, exmem.pc);
+    case OP_SW:
+        return dcache->setCacheValue(addr, iData.rtValue, WORD_SIZE, pipeState.cycle, readyCycle, exmem.pc);
+    case OP_LBU:
+        delay = dcache->getCacheValue(addr, data, BYTE_SIZE, pipeState.cycle, readyCycle, exmem.pc);
+        break;
+    case OP_LHU:
+        delay = dcache->getCacheValue(addr, data, HALF_SIZE, pipeState.cycle, readyCycle, exmem.pc);
+        break;
+    case OP_LW:
+        delay = dcache->getCacheValue(addr, data, WORD_SIZE, pipeState.cycle, readyCycle, exmem.pc);
+        break;
+    default:
+        return 0;
+    }
+
+    if (!delay)
+    {
+        exmem.regWriteValue = data;
+        if (exmem.regToWrite != 0)
+        {
+            regReadyCycle[exmem.regToWrite] = readyCycle;
+        }
+    }
+    return delay;
+}
+
 // returns true when stall, false otherwise
-int handleMem(EXMEM &exmem)
+int Simulator::Machine::handleMem(EXMEM &exmem)
 {
     IData &iData = exmem.instructionData.data.iData;
     uint32_t addr = iData.rsValue + iData.seImm;
     uint32_t data = 0;
     
     int delay = 0;
+    if (dcache->isNonBlocking())
+    {
+        return handleMemNonBlocking(exmem, addr);
+    }
     switch (iData.opcode)
     {
     case OP_SB:
-        return dcache->setCacheValue(addr, iData.rtValue, BYTE_SIZE, pipeState.cycle);
+        return dcache->setCacheValue(addr, iData.rtValue, BYTE_SIZE, pipeState.cycle, exmem.pc);
     case OP_SH:
-        return dcache->setCacheValue(addr, iData.rtValue, HALF_SIZE, pipeState.cycle);
+        return dcache->setCacheValue(addr, iData.rtValue, HALF_SIZE, pipeState.cycle, exmem.pc);
     case OP_SW:
-        return dcache->setCacheValue(addr, iData.rtValue, WORD_SIZE, pipeState.cycle);
+        return dcache->setCacheValue(addr, iData.rtValue, WORD_SIZE, pipeState.cycle, exmem.pc);
     case OP_LBU:
-        if (delay = dcache->getCacheValue(addr, data, BYTE_SIZE, pipeState.cycle))
+        if (delay = dcache->getCacheValue(addr, data, BYTE_SIZE, pipeState.cycle, exmem.pc))
         {
             return delay;
         }
@@ -848,7 +847,7 @@ int handleMem(EXMEM &exmem)
             exmem.regWriteValue = data;
         break;
     case OP_LHU:
-        if (delay = dcache->getCacheValue(addr, data, HALF_SIZE, pipeState.cycle))
+        if (delay = dcache->getCacheValue(addr, data, HALF_SIZE, pipeState.cycle, exmem.pc))
         {
 
             return delay;
@@ -857,7 +856,7 @@ int handleMem(EXMEM &exmem)
             exmem.regWriteValue = data;
         break;
     case OP_LW:
-        if (delay = dcache->getCacheValue(addr, data, WORD_SIZE, pipeState.cycle))
+        if (delay = dcache->getCacheValue(addr, data, WORD_SIZE, pipeState.cycle, exmem.pc))
         {
             return delay;
         }
@@ -868,17 +867,125 @@ int handleMem(EXMEM &exmem)
     return 0;
 }
 
-bool branchNeedsStall(InstructionData &currentInstr, IDEX &nextInstr, EXMEM &nextNextInstr, bool checkRt)
+bool isConditionalBranch(InstructionData &instr)
 {
-    auto rs = currentInstr.rs();
-    auto rt = currentInstr.rt();
-
-    if (rs == nextNextInstr.regToWrite && nextNextInstr.regToWrite != 0 && nextNextInstr.instructionData.isMemRead())
+    if (instr.tag != I)
     {
-        return true;
+        return false;
     }
-
-    if (checkRt && rt == nextNextInstr.regToWrite && nextNextInstr.regToWrite != 0 && nextNextInstr.instructionData.isMemRead())
+    switch (instr.data.iData.opcode)
+    {
+    case OP_BEQ:
+    case OP_BNE:
+    case OP_BGTZ:
+    case OP_BLEZ:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool branchTaken(IData &iData)
+{
+    switch (iData.opcode)
+    {
+    case OP_BEQ:
+        return iData.rsValue == iData.rtValue;
+    case OP_BNE:
+        return iData.rsValue != iData.rtValue;
+    case OP_BGTZ:
+        return static_cast<int32_t>(iData.rsValue) > 0;
+    case OP_BLEZ:
+        return static_cast<int32_t>(iData.rsValue) <= 0;
+    default:
+        return false;
+    }
+}
+
+uint32_t branchTarget(uint32_t branchPc, IData &iData)
+{
+    return branchPc + 4 + ((static_cast<int32_t>(iData.seImm)) << 2);
+}
+
+// a jr target to go on with while its register is not ready: the top of the return address
+// stack for jr $ra, otherwise the last target seen at this pc
+bool Simulator::Machine::predictJumpTarget(uint32_t jumpPc, uint8_t rs, uint32_t &target)
+{
+    if (rs == REG_RA)
+    {
+        return returnStack->peek(target);
+    }
+    return branchTargets->lookup(jumpPc, target);
+}
+
+// called as a control instruction leaves execute, where all of its operands have been forwarded.
+// trains the predictor and returns true, with the pc fetch should have gone to, if the
+// instruction had left decode on a wrong guess
+bool Simulator::Machine::resolveBranch(IDEX &branch, uint32_t &resolvedPc)
+{
+    InstructionData &instr = branch.instructionData;
+    bool isJr = instr.tag == R && instr.data.rData.funct == FUN_JR;
+    bool isJal = instr.tag == J && instr.data.jData.opcode == OP_JAL;
+
+    if (isJal)
+    {
+        returnStack->push(branch.pc + 8);
+        return false;
+    }
+    if (isJr)
+    {
+        resolvedPc = instr.data.rData.rsValue;
+        if (instr.data.rData.rs == REG_RA)
+        {
+            returnStack->pop();
+        }
+        else
+        {
+            branchTargets->update(branch.pc, resolvedPc);
+        }
+    }
+    else if (isConditionalBranch(instr))
+    {
+        bool taken = branchTaken(instr.data.iData);
+        branchStats.branches++;
+        if (taken == branch.predictedTaken)
+        {
+            branchStats.correct++;
+        }
+        branchPredictor->update(branch.pc, taken);
+        resolvedPc = taken ? branchTarget(branch.pc, instr.data.iData) : branch.pc + 8;
+    }
+    else
+    {
+        return false;
+    }
+
+    if (!branch.speculative)
+    {
+        return false;
+    }
+    branchStats.speculated++;
+    if (resolvedPc != branch.predictedPc)
+    {
+        branchStats.mispredicts++;
+        return true;
+    }
+    // the decode stall the guess replaced
+    branchStats.savedCycles++;
+    return false;
+}
+
+bool branchNeedsStall(InstructionData &currentInstr, IDEX &nextInstr, EXMEM &nextNextInstr, bool checkRt)
+{
+    auto rs = currentInstr.rs();
+    auto rt = currentInstr.rt();
+
+    if (rs == nextNextInstr.regToWrite && nextNextInstr.regToWrite != 0 && nextNextInstr.instructionData.isMemRead())
+    {
+        return true;
+    }
+
+    if (checkRt && rt == nextNextInstr.regToWrite && nextNextInstr.regToWrite != 0 && nextNextInstr.instructionData.isMemRead())
     {
         return true;
     }
@@ -916,6 +1023,13 @@ void handleMemForwarding(InstructionData &instr, MEMWB &memwb)
     }
 }
 
+// whether an instruction in decode reads a register whose load data has not arrived yet. it would
+// reach execute next cycle, after the data, only if the data arrives by this cycle
+bool Simulator::Machine::registerPending(InstructionData &instr)
+{
+    return regReadyCycle[instr.rs()] > pipeState.cycle || regReadyCycle[instr.rt()] > pipeState.cycle;
+}
+
 bool isFuncCodeValid(uint8_t funct)
 {
     switch (funct)
@@ -938,7 +1052,7 @@ bool isFuncCodeValid(uint8_t funct)
     }
 }
 
-CycleStatus runCycle()
+CycleStatus Simulator::Machine::runCycle()
 {
     IFID nextIfid{};
     IDEX nextIdex{};
@@ -948,6 +1062,13 @@ CycleStatus runCycle()
     bool stallIf = false;
     bool stallId = false;
     bool stallMem = false;
+    // decode raised an exception, which takes priority over redirecting a mispredicted branch
+    bool idException = false;
+
+    if (cycleStatus == FAULTED)
+    {
+        return cycleStatus;
+    }
 
     // if simulated cache miss time is not over yet
     if (--memHaltCycles > 0) {
@@ -965,6 +1086,7 @@ CycleStatus runCycle()
     {
         regs[memwb.regToWrite] = memwb.regWriteValue;
     }
+    if (memwb.valid) retiredInstructions++;
 
     nextIfid.pc = pc;
 
@@ -976,11 +1098,13 @@ CycleStatus runCycle()
     // this avoids that by maintaining a "cache" for the last fetched instruction that won't increment icache hits
     if (lastPcFetch == pc) {
         instruction = lastInstructionFetch;
+        nextIfid.valid = true;
     }
 
     else if (!haltSeen && --fetchHaltCycles <= 0)
     {
-        auto delay = icache->getCacheValue(pc, instruction, MemEntrySize::WORD_SIZE, pipeState.cycle);
+        auto delay = icache->getCacheValue(pc, instruction, MemEntrySize::WORD_SIZE, pipeState.cycle, pc);
+        if (trace) traceAccess(TRACE_FETCH, pc, WORD_SIZE, delay);
         if (delay)
         {
             // cache miss, halt
@@ -989,6 +1113,7 @@ CycleStatus runCycle()
         } else {
             lastPcFetch = pc;
             lastInstructionFetch = instruction;
+            nextIfid.valid = true;
         }
     }
 
@@ -1009,8 +1134,10 @@ CycleStatus runCycle()
         // Illegal instruction exception check
         if (!isFuncCodeValid(nextIdex.instructionData.data.rData.funct))
         {
+            idException = true;
             nextPc = EXCEPTION_ADDR;
             nextIfid.instruction = 0;
+            nextIfid.valid = false;
             haltSeen = false;
             nextIdex.instructionData = InstructionData{};
             break;
@@ -1020,6 +1147,18 @@ CycleStatus runCycle()
             handleBranchForwarding(nextIdex.instructionData, exmem);
             nextPc = nextIdex.instructionData.data.rData.rsValue;
             stallId = branchNeedsStall(nextIdex.instructionData, idex, exmem, false);
+
+            // go on to a predicted target and check it in execute. the delay slot has to be
+            // fetched already, or the redirect would be lost with it
+            uint32_t target;
+            if (stallId && branchPredictor && !stallIf &&
+                predictJumpTarget(ifid.pc, nextIdex.instructionData.data.rData.rs, target))
+            {
+                stallId = false;
+                nextPc = target;
+                nextIdex.speculative = true;
+                nextIdex.predictedPc = target;
+            }
         }
         else
         {
@@ -1034,37 +1173,33 @@ CycleStatus runCycle()
         switch (iData.opcode)
         {
         case OP_BEQ:
-            handleBranchForwarding(nextIdex.instructionData, exmem);
-            if (iData.rsValue == iData.rtValue)
-            {
-                nextPc = ifid.pc + 4 + ((static_cast<int32_t>(iData.seImm)) << 2);
-            }
-            stallId = branchNeedsStall(nextIdex.instructionData, idex, exmem, true);
-            break;
         case OP_BNE:
-            handleBranchForwarding(nextIdex.instructionData, exmem);
-            if (iData.rsValue != iData.rtValue)
-            {
-                nextPc = ifid.pc + 4 + ((static_cast<int32_t>(iData.seImm)) << 2);
-            }
-            stallId = branchNeedsStall(nextIdex.instructionData, idex, exmem, true);
-            break;
         case OP_BGTZ:
+        case OP_BLEZ:
+        {
+            uint32_t fallThrough = nextPc;
             handleBranchForwarding(nextIdex.instructionData, exmem);
-            if (iData.rsValue > 0)
+            if (branchTaken(iData))
             {
-                nextPc = ifid.pc + 4 + ((static_cast<int32_t>(iData.seImm)) << 2);
+                nextPc = branchTarget(ifid.pc, iData);
             }
-            stallId = branchNeedsStall(nextIdex.instructionData, idex, exmem, false);
-            break;
-        case OP_BLEZ:
-            handleBranchForwarding(nextIdex.instructionData, exmem);
-            if (iData.rsValue <= 0)
+            // only beq and bne compare rt
+            stallId = branchNeedsStall(nextIdex.instructionData, idex, exmem, iData.opcode == OP_BEQ || iData.opcode == OP_BNE);
+
+            if (branchPredictor)
             {
-                nextPc = ifid.pc + 4 + ((static_cast<int32_t>(iData.seImm)) << 2);
+                nextIdex.predictedTaken = branchPredictor->predict(ifid.pc);
+                // go on down the predicted path and check it in execute, as for jr above
+                if (stallId && !stallIf)
+                {
+                    stallId = false;
+                    nextPc = nextIdex.predictedTaken ? branchTarget(ifid.pc, iData) : fallThrough;
+                    nextIdex.speculative = true;
+                    nextIdex.predictedPc = nextPc;
+                }
             }
-            stallId = branchNeedsStall(nextIdex.instructionData, idex, exmem, false);
             break;
+        }
         case OP_SB:
         case OP_SH:
         case OP_SW:
@@ -1092,13 +1227,25 @@ CycleStatus runCycle()
         break;
     }
     case E:
+        idException = true;
         nextPc = EXCEPTION_ADDR;
         nextIfid.instruction = 0; // squash instruction after illegal instruction exception
+        nextIfid.valid = false;
         haltSeen = false;
         nextIdex = IDEX{};
     }
+    // a jump or taken branch whose delay slot is still being fetched waits in decode for it,
+    // since the stalled fetch keeps the pc and the redirect would be lost
+    if (fetchHaltCycles > 0 && nextPc != pc && !idException)
+    {
+        stallId = true;
+    }
     if (nextIdex.instructionData.tag != E)
+    {
         nextIdex.instruction = ifid.instruction;
+        nextIdex.pc = ifid.pc;
+        nextIdex.valid = ifid.valid;
+    }
 
     // if (ID/EX.MemRead and
     //  ((ID/EX.RegisterRt = IF/ID.RegisterRs) or
@@ -1160,6 +1307,7 @@ CycleStatus runCycle()
     {
         nextPc = EXCEPTION_ADDR;
         nextIfid.instruction = 0;
+        nextIfid.valid = false;
         nextIdex = IDEX{};
         nextExmem = EXMEM{};
         haltSeen = false;
@@ -1170,12 +1318,25 @@ CycleStatus runCycle()
     {
         handleMemForwarding(exmem.instructionData, memwb);
         auto delay = handleMem(exmem);
+        if (trace) traceMem(exmem, delay);
         if (delay) {
             memHaltCycles = delay;
             stallMem = true;
         }
     }
 
+    // a later write to a register replaces whatever load data it was still waiting on
+    if (!stallMem && exmem.regToWrite != 0 && !exmem.instructionData.isMemRead())
+    {
+        regReadyCycle[exmem.regToWrite] = 0;
+    }
+
+    // this also catches an instruction decoded in the same cycle as the miss
+    if (registerPending(nextIdex.instructionData))
+    {
+        stallId = true;
+    }
+
     nextMemwb = exmem;
 
     // writeback trigger halt
@@ -1183,6 +1344,13 @@ CycleStatus runCycle()
         cycleStatus = HALTED;
 
 
+    // a branch leaving execute trains the predictor, and a wrong guess redirects fetch
+    uint32_t resolvedPc = 0;
+    bool mispredicted = branchPredictor && !stallMem && resolveBranch(idex, resolvedPc) && !idException;
+    // the delay slot is in decode and anything fetched since is on the wrong path, so only a halt
+    // in the delay slot still counts
+    bool delaySlotHalts = ifid.instruction == 0xfeedfeed;
+
     // update pipe state information
     pipeState.cycle++;
     pipeState.ifInstr = nextIfid.instruction;
@@ -1201,12 +1369,24 @@ CycleStatus runCycle()
         pc = nextPc;
     }
 
-    if (stallIf)
+    if (stallIf && !stallId && !stallMem)
     {
-        // insert bubble
+        // insert bubble, unless decode is holding its instruction in IF/ID
         ifid = IFID{};
     }
 
+    if (mispredicted)
+    {
+        // flush the wrong-path fetch, along with any miss it was waiting on
+        if (!stallId)
+        {
+            ifid = IFID{};
+        }
+        pc = resolvedPc;
+        fetchHaltCycles = 0;
+        haltSeen = delaySlotHalts;
+    }
+
     if (!stallId && !stallMem)
     {
         idex = nextIdex;
@@ -1231,53 +1411,842 @@ CycleStatus runCycle()
     return cycleStatus;
 }
 
-int runCycles(unsigned int cycles)
+// a slot holding nothing: never fetched, and decoded, if at all, from the word 0, an sll to $zero
+static bool isBubble(const IFID &slot)
+{
+    return !slot.valid && slot.instruction == 0;
+}
+
+static bool isBubble(const IDEX &slot)
+{
+    return !slot.valid && slot.instruction == 0 && slot.regToWrite == 0 && !slot.speculative &&
+           slot.instructionData.tag == R && slot.instructionData.data.rData.funct == FUN_SLL;
+}
+
+// a miss holds the pipeline for its whole latency, and runCycle would spend most of those cycles
+// only counting them down. counts up to limit such cycles at once, leaving the machine as running
+// them would have, and returns how many; 0 when the next cycle does real work
+uint32_t Simulator::Machine::skipStalledCycles(uint32_t limit)
+{
+    if (cycleStatus != NOT_HALTED)
+    {
+        return 0;
+    }
+
+    uint32_t skipped;
+    if (memHaltCycles > 1)
+    {
+        // runCycle's early return: the memory stage waits, and a stalled fetch counts down with it
+        skipped = min<uint32_t>(limit, memHaltCycles - 1);
+        memHaltCycles -= skipped;
+        if (fetchHaltCycles > 0) fetchHaltCycles = max<int>(fetchHaltCycles - (int)skipped, 0);
+    }
+    else if (fetchHaltCycles > 1 && !haltSeen && lastPcFetch != pc && isBubble(ifid) && isBubble(idex) &&
+             isBubble(exmem) && isBubble(memwb))
+    {
+        // fetch waits on the I-cache with nothing behind it, so each cycle only moves bubbles
+        // along and leaves every stage of the pipe state empty
+        skipped = min<uint32_t>(limit, fetchHaltCycles - 1);
+        fetchHaltCycles -= skipped;
+        memHaltCycles = 0;
+        pipeState.ifInstr = pipeState.idInstr = pipeState.exInstr = pipeState.memInstr = pipeState.wbInstr = 0;
+    }
+    else
+    {
+        return 0;
+    }
+    pipeState.cycle += skipped;
+    simStats.totalCycles += skipped;
+    return skipped;
+}
+
+int Simulator::Machine::runCycles(uint32_t cycles)
 {
     CycleStatus cycleStatus{};
-    for (; cycles > 0 && cycleStatus != HALTED; cycles--)
+    while (cycles > 0 && cycleStatus == NOT_HALTED)
     {
-        cycleStatus = runCycle();
+        uint32_t skipped = skipStalledCycles(cycles);
+        if (skipped)
+        {
+            cycles -= skipped;
+        }
+        else
+        {
+            cycleStatus = runCycle();
+            cycles--;
+        }
     }
-    pipeState.cycle--;
-    dumpPipeState(pipeState);
-    pipeState.cycle++;
-    return cycleStatus == HALTED;
+    return cycleStatus == FAULTED ? -EINVAL : cycleStatus == HALTED;
 }
-int runTillHalt()
+
+int Simulator::Machine::runTillHalt()
 {
     CycleStatus cycleStatus{};
-    do
+    while (cycleStatus == NOT_HALTED)
     {
-        cycleStatus = runCycle();
-    } while (cycleStatus != HALTED);
-    pipeState.cycle--;
-    dumpPipeState(pipeState);
-    pipeState.cycle++;
-    return 0;
+        if (!skipStalledCycles(UINT32_MAX)) cycleStatus = runCycle();
+    }
+    return cycleStatus == FAULTED ? -EINVAL : 0;
 }
-int finalizeSimulator()
+
+int Simulator::Machine::runInstructions(uint64_t instructions)
+{
+    uint64_t target = retiredInstructions + instructions;
+    CycleStatus cycleStatus{};
+    while (retiredInstructions < target && cycleStatus == NOT_HALTED)
+    {
+        if (!skipStalledCycles(UINT32_MAX)) cycleStatus = runCycle();
+    }
+    return cycleStatus == FAULTED ? -EINVAL : cycleStatus == HALTED;
+}
+
+// appends what printSimStats does not know about, the shared cache levels and the non-blocking
+// D-cache, to the stats it wrote, in the same layout
+static void printPrefetchStats(ofstream &statsFile, const string &name, Cache *cache)
+{
+    PrefetchStats prefetchStats = cache->getPrefetchStats();
+    statsFile << left << setw(20) << name + " pf issued:" << prefetchStats.issued << endl;
+    statsFile << left << setw(20) << name + " pf useful:" << prefetchStats.useful << endl;
+    statsFile << left << setw(20) << name + " pf late:" << prefetchStats.late << endl;
+    statsFile << left << setw(20) << name + " pf useless:" << prefetchStats.useless << endl;
+    statsFile << left << setw(20) << name + " pollution:" << prefetchStats.pollution << endl;
+}
+
+static void printVictimStats(ofstream &statsFile, const string &name, Cache *cache)
+{
+    VictimCacheStats victimStats = cache->getVictimStats();
+    statsFile << left << setw(20) << name + " VC hits:" << victimStats.hits << endl;
+    statsFile << left << setw(20) << name + " VC evicts:" << victimStats.evictions << endl;
+    statsFile << left << setw(20) << name + " VC saved:" << victimStats.savedCycles << endl;
+}
+
+static void printWriteBufferStats(ofstream &statsFile, const string &name, Cache *cache)
+{
+    WriteBufferStats bufferStats = cache->getWriteBufferStats();
+    statsFile << left << setw(20) << name + " WB writes:" << bufferStats.buffered << endl;
+    statsFile << left << setw(20) << name + " WB merged:" << bufferStats.merged << endl;
+    statsFile << left << setw(20) << name + " WB full:" << bufferStats.fullStalls << endl;
+    statsFile << left << setw(20) << name + " WB stall:" << bufferStats.stallCycles << endl;
+}
+
+void Simulator::Machine::printBranchStats(ofstream &statsFile)
+{
+    statsFile << left << setw(20) << "BP branches:" << branchStats.branches << endl;
+    statsFile << left << setw(20) << "BP correct:" << branchStats.correct << endl;
+    statsFile << left << setw(20) << "BP accuracy:" << fixed << setprecision(2)
+              << (branchStats.branches ? 100.0 * branchStats.correct / branchStats.branches : 0.0) << endl;
+    statsFile << left << setw(20) << "BP speculated:" << branchStats.speculated << endl;
+    statsFile << left << setw(20) << "BP mispredicts:" << branchStats.mispredicts << endl;
+    statsFile << left << setw(20) << "BP saved cycles:" << branchStats.savedCycles << endl;
+}
+
+void Simulator::Machine::printExtraSimStats()
+{
+    bool extras = false;
+    for (Cache *cache : {icache, dcache})
+    {
+        extras |= cache->hasPrefetcher() || cache->hasVictimCache() || cache->hasWriteBuffer() ||
+                  cache->getWriteBufferStats().stallCycles != 0;
+    }
+    if (lowerCaches.empty() && !dcache->isNonBlocking() && !extras && !branchPredictor)
+    {
+        return;
+    }
+
+    ofstream statsFile(reportPath("sim_stats.out"), ios::app);
+    if (!statsFile)
+    {
+        cout << "Could not open sim stats file!" << endl;
+        return;
+    }
+
+    if (dcache->isNonBlocking())
+    {
+        MshrStats mshrStats = dcache->getMshrStats();
+        statsFile << left << setw(20) << "D-cache merges:" << mshrStats.merges << endl;
+        statsFile << left << setw(20) << "D-cache MSHR full:" << mshrStats.fullStalls << endl;
+        statsFile << left << setw(20) << "D-cache MLP:" << fixed << setprecision(2)
+                  << (mshrStats.missCycles ? (double) mshrStats.busyCycles / mshrStats.missCycles : 0.0) << endl;
+    }
+
+    if (icache->hasPrefetcher())
+    {
+        printPrefetchStats(statsFile, "I-cache", icache);
+    }
+    if (dcache->hasPrefetcher())
+    {
+        printPrefetchStats(statsFile, "D-cache", dcache);
+    }
+    if (icache->hasVictimCache())
+    {
+        printVictimStats(statsFile, "I-cache", icache);
+    }
+    if (dcache->hasVictimCache())
+    {
+        printVictimStats(statsFile, "D-cache", dcache);
+    }
+    // without a buffer, the writeback stall is still worth showing when writebacks take time
+    if (dcache->hasWriteBuffer() || dcache->getWriteBufferStats().stallCycles != 0)
+    {
+        printWriteBufferStats(statsFile, "D-cache", dcache);
+    }
+
+    if (branchPredictor)
+    {
+        printBranchStats(statsFile);
+    }
+
+    for (uint32_t i = 0; i < lowerCaches.size(); i++)
+    {
+        CacheLevelStats levelStats = lowerCaches[i]->getLevelStats();
+        string level = "L" + to_string(i + 2);
+        statsFile << left << setw(20) << level + " hits:" << levelStats.hits << endl;
+        statsFile << left << setw(20) << level + " misses:" << levelStats.misses << endl;
+        statsFile << left << setw(20) << level + " writebacks:" << levelStats.writebacks << endl;
+    }
+}
+
+static void printCurvePoint(ofstream &curveFile, StackDistanceProfiler *profile, uint32_t cacheSize, uint32_t blockSize, uint32_t assoc)
+{
+    uint64_t accesses = profile->getAccesses();
+    uint64_t hits = profile->getHits(cacheSize, blockSize, assoc);
+    curveFile << right << setw(8) << cacheSize << setw(8) << blockSize << setw(8) << assoc
+              << setw(12) << hits << setw(12) << accesses - hits << setw(12) << fixed << setprecision(2)
+              << (accesses ? 100.0 * (accesses - hits) / accesses : 0.0) << endl;
+}
+
+// one line per profiled cache: size, block size, ways (0 for fully associative), hits, misses
+// and miss rate. a fully associative cache with no more blocks than maxAssociativity ways is
+// already listed under its way count
+void Simulator::Machine::printCacheCurve(ofstream &curveFile, const string &name, StackDistanceProfiler *profile)
+{
+    curveFile << name << " accesses: " << profile->getAccesses() << endl;
+    curveFile << right << setw(8) << "size" << setw(8) << "block" << setw(8) << "ways"
+              << setw(12) << "hits" << setw(12) << "misses" << setw(12) << "miss rate" << endl;
+    for (uint32_t blockSize = analysisConfig.minBlockSize; blockSize <= analysisConfig.maxBlockSize; blockSize *= 2)
+    {
+        for (uint32_t cacheSize = max(analysisConfig.minCacheSize, blockSize); cacheSize <= analysisConfig.maxCacheSize; cacheSize *= 2)
+        {
+            uint32_t numBlocks = cacheSize / blockSize;
+            for (uint32_t assoc = 1; assoc <= min(analysisConfig.maxAssociativity, numBlocks); assoc *= 2)
+            {
+                printCurvePoint(curveFile, profile, cacheSize, blockSize, assoc);
+            }
+            if (numBlocks > analysisConfig.maxAssociativity)
+            {
+                printCurvePoint(curveFile, profile, cacheSize, blockSize, 0);
+            }
+        }
+    }
+}
+
+void Simulator::Machine::printCacheAnalysis()
+{
+    if (!icacheProfile)
+    {
+        return;
+    }
+
+    ofstream curveFile(reportPath("cache_curve.out"));
+    if (!curveFile)
+    {
+        cout << "Could not open cache curve file!" << endl;
+        return;
+    }
+    printCacheCurve(curveFile, "I-cache", icacheProfile);
+    curveFile << endl;
+    printCacheCurve(curveFile, "D-cache", dcacheProfile);
+}
+
+SimulationStats Simulator::Machine::getStats()
 {
-    // Set the register values in the struct for printing...
     SimulationStats s;
     s.totalCycles = pipeState.cycle;
     s.icHits = icache->getHits();
     s.icMisses = icache->getMisses();
     s.dcHits = dcache->getHits();
     s.dcMisses = dcache->getMisses();
-    printSimStats(s);
-
-    icache->drain();
-    dcache->drain();
+    return s;
+}
 
+// frees the caches, predictor and profilers. the memory store belongs to the caller
+void Simulator::Machine::release()
+{
     delete icache;
     delete dcache;
+    for (Cache *level : lowerCaches)
+    {
+        delete level;
+    }
+    icache = nullptr;
+    dcache = nullptr;
+    lowerCaches.clear();
+    delete branchPredictor;
+    delete branchTargets;
+    delete returnStack;
+    branchPredictor = nullptr;
+    branchTargets = nullptr;
+    returnStack = nullptr;
+    delete icacheProfile;
+    delete dcacheProfile;
+    icacheProfile = nullptr;
+    dcacheProfile = nullptr;
+    // closing the trace writes out the rest of it
+    delete trace;
+    trace = nullptr;
+}
+
+string Simulator::Machine::reportPath(const char *name)
+{
+    return reportDirectory.empty() ? string(name) : reportDirectory + "/" + name;
+}
+
+// as printSimStats, which can only write to the working directory
+static void writeSimStats(const string &path, SimulationStats &s)
+{
+    ofstream statsFile(path);
+    if (!statsFile)
+    {
+        cout << "Could not open sim stats file!" << endl;
+        return;
+    }
+    statsFile << left << setw(20) << "Total cycles:" << s.totalCycles << endl;
+    statsFile << left << setw(20) << "I-cache hits:" << s.icHits << endl;
+    statsFile << left << setw(20) << "I-cache misses:" << s.icMisses << endl;
+    statsFile << left << setw(20) << "D-cache hits:" << s.dcHits << endl;
+    statsFile << left << setw(20) << "D-cache misses:" << s.dcMisses << endl;
+}
+
+// as dumpRegisterState and dumpMemoryState, to the files named rather than the working directory
+static void writeState(const string &regPath, const string &memPath, RegisterInfo &reg, MemoryStore *mem)
+{
+    ofstream regFile(regPath);
+    ofstream memFile(memPath);
+    if (!regFile || !memFile)
+    {
+        cout << "Could not open state dump files!" << endl;
+        return;
+    }
+    printRegisterState(reg, regFile);
+    printMemoryState(mem, memFile);
+}
+
+int Simulator::Machine::finalize()
+{
+    // Set the register values in the struct for printing...
+    SimulationStats s = getStats();
+    if (reportDirectory.empty()) printSimStats(s);
+    else writeSimStats(reportPath("sim_stats.out"), s);
+    printExtraSimStats();
+    printCacheAnalysis();
+
+    // top down, so every dirty block reaches memory
+    icache->drain();
+    dcache->drain();
+    for (Cache *level : lowerCaches)
+    {
+        level->drain();
+    }
+    release();
 
     RegisterInfo reg;
     memset(&reg, 0, sizeof(RegisterInfo));
     fillRegisterState(reg);
 
+    if (!reportDirectory.empty())
+    {
+        writeState(reportPath("reg_state.out"), reportPath("mem_state.out"), reg, memStore);
+        return 0;
+    }
     dumpRegisterState(reg);
-    dumpMemoryState(memStore);
+    // the prebuilt dump only reads its own store
+    if (FlatMemoryStore *flatMem = dynamic_cast<FlatMemoryStore *>(memStore)) dumpMemoryState(flatMem);
+    else if (SparseMemoryStore *sparseMem = dynamic_cast<SparseMemoryStore *>(memStore)) dumpMemoryState(sparseMem);
+    else dumpMemoryState(memStore);
 
     return 0;
-}
\ No newline at end of file
+}
+
+// CHECKPOINTS
+// the file layout is in SnapshotFile.h. a checkpoint of this simulator has the machine and cache
+// sections; one from ./sim --fast-forward has only the architectural state, and starts the
+// pipeline empty at its pc
+
+// the machine apart from its caches and memory
+struct MachineSnapshot
+{
+    CacheConfig icacheConfig;
+    CacheConfig dcacheConfig;
+    uint32_t regs[NUM_REGS];
+    uint32_t regReadyCycle[NUM_REGS];
+    PipeState pipeState;
+    uint32_t pc;
+    IFID ifid;
+    IDEX idex;
+    EXMEM exmem;
+    MEMWB memwb;
+    uint32_t haltSeen;
+    int32_t fetchHaltCycles;
+    int32_t memHaltCycles;
+    uint32_t lastPcFetch;
+    uint32_t lastInstructionFetch;
+    uint32_t cycleStatus;
+    SimulationStats simStats;
+    uint64_t retiredInstructions;
+};
+
+static bool sameCacheConfig(const CacheConfig &a, const CacheConfig &b)
+{
+    return a.cacheSize == b.cacheSize && a.blockSize == b.blockSize && a.type == b.type &&
+           a.missLatency == b.missLatency && a.associativity == b.associativity &&
+           a.replacement == b.replacement && a.mshrs == b.mshrs && a.prefetcher == b.prefetcher &&
+           a.victimBlocks == b.victimBlocks && a.writebackLatency == b.writebackLatency &&
+           a.writeBufferEntries == b.writeBufferEntries;
+}
+
+// the memory a snapshot holds: every page a sparse store has allocated, or all of any other store
+// but the last byte, which the stores in this tree and the prebuilt one never accept
+static vector<SnapshotRun> snapshotRuns(MemoryStore *mem)
+{
+    vector<SnapshotRun> runs;
+    if (SparseMemoryStore *sparseMem = dynamic_cast<SparseMemoryStore *>(mem))
+    {
+        for (uint32_t address : sparseMem->getPageAddresses())
+        {
+            runs.push_back(SnapshotRun{address, SPARSE_PAGE_SIZE, 0});
+        }
+    }
+    else
+    {
+        runs.push_back(SnapshotRun{0, MEMORY_SIZE - 1, 0});
+    }
+    return runs;
+}
+
+int Simulator::Machine::checkpoint(const char *fileName)
+{
+    if (!icache)
+    {
+        cout << "No simulation to checkpoint" << endl;
+        return -EINVAL;
+    }
+    if (!icache->canCheckpoint() || !dcache->canCheckpoint() || !lowerCaches.empty() || branchPredictor || icacheProfile)
+    {
+        cout << "Only L1 caches without MSHRs, prefetchers, victim caches or write buffers, and no branch "
+             << "predictor or cache analysis, can be checkpointed" << endl;
+        return -EINVAL;
+    }
+
+    SnapshotHeader header;
+    vector<SnapshotRun> runs = snapshotRuns(memStore);
+    uint64_t size = layoutSnapshot(header, sizeof(MachineSnapshot), icache->checkpointSize(), dcache->checkpointSize(), 0, runs);
+    uint8_t *image = createSnapshotFile(fileName, size);
+    if (!image)
+    {
+        return -EBADF;
+    }
+
+    MachineSnapshot machineState{};
+    machineState.icacheConfig = icacheConfig;
+    machineState.dcacheConfig = dcacheConfig;
+    memcpy(machineState.regs, regs, sizeof(regs));
+    memcpy(machineState.regReadyCycle, regReadyCycle, sizeof(regReadyCycle));
+    machineState.pipeState = pipeState;
+    machineState.pc = pc;
+    machineState.ifid = ifid;
+    machineState.idex = idex;
+    machineState.exmem = exmem;
+    machineState.memwb = memwb;
+    machineState.haltSeen = haltSeen;
+    machineState.fetchHaltCycles = fetchHaltCycles;
+    machineState.memHaltCycles = memHaltCycles;
+    machineState.lastPcFetch = lastPcFetch;
+    machineState.lastInstructionFetch = lastInstructionFetch;
+    machineState.cycleStatus = cycleStatus;
+    machineState.simStats = simStats;
+    machineState.retiredInstructions = retiredInstructions;
+
+    memcpy(image, &header, sizeof(header));
+    memcpy(image + header.machine.offset, &machineState, sizeof(machineState));
+    icache->saveCheckpoint(image + header.icache.offset);
+    dcache->saveCheckpoint(image + header.dcache.offset);
+    memcpy(image + header.runs.offset, runs.data(), header.runs.size);
+    int ret = 0;
+    for (SnapshotRun &run : runs)
+    {
+        if (::getMemBlock(memStore, run.address, image + run.offset, run.size)) ret = -EINVAL;
+    }
+
+    if (munmap(image, size) != 0) ret = -EBADF;
+    return ret;
+}
+
+// with no configs given, the caches are rebuilt as they were. a cache given a different config
+// starts empty, once the blocks the checkpoint held dirty have been written back to memory. a
+// snapshot of the architectural state alone has no caches, so it needs configs
+int Simulator::Machine::restore(const char *fileName, CacheConfig *icConfig, CacheConfig *dcConfig, MemoryStore *mainMem)
+{
+    uint64_t size;
+    const uint8_t *image = openSnapshotFile(fileName, size);
+    if (!image)
+    {
+        return -EBADF;
+    }
+
+    SnapshotHeader header;
+    if (!checkSnapshotHeader(image, size, header) ||
+        (header.machine.size != 0 && header.machineSize != sizeof(MachineSnapshot)) ||
+        (header.machine.size == 0 && header.arch.size != sizeof(ArchSnapshot)))
+    {
+        munmap(const_cast<uint8_t *>(image), size);
+        cout << fileName << " is not a version " << SNAPSHOT_VERSION << " checkpoint from this build" << endl;
+        return -EINVAL;
+    }
+    bool archOnly = header.machine.size == 0;
+    if (archOnly && (!icConfig || !dcConfig))
+    {
+        munmap(const_cast<uint8_t *>(image), size);
+        cout << fileName << " holds no caches, so it needs cache configs to carry on from" << endl;
+        return -EINVAL;
+    }
+
+    MachineSnapshot machineState{};
+    ArchSnapshot archState{};
+    if (archOnly) memcpy(&archState, image + header.arch.offset, sizeof(archState));
+    else memcpy(&machineState, image + header.machine.offset, sizeof(machineState));
+    CacheConfig newIcacheConfig = icConfig ? *icConfig : machineState.icacheConfig;
+    CacheConfig newDcacheConfig = dcConfig ? *dcConfig : machineState.dcacheConfig;
+    if (int err = init(newIcacheConfig, newDcacheConfig, nullptr, 0, mainMem))
+    {
+        munmap(const_cast<uint8_t *>(image), size);
+        return err;
+    }
+
+    int ret = 0;
+    for (uint32_t i = 0; i < header.runCount; i++)
+    {
+        SnapshotRun run;
+        memcpy(&run, image + header.runs.offset + i * sizeof(SnapshotRun), sizeof(run));
+        if (!snapshotHolds(size, SnapshotSection{run.offset, run.size}) ||
+            ::setMemBlock(mainMem, run.address, image + run.offset, run.size))
+        {
+            ret = -EINVAL;
+        }
+    }
+
+    struct
+    {
+        Cache *cache;
+        CacheConfig &config;
+        CacheConfig &savedConfig;
+        SnapshotSection &section;
+    } caches[] = {{icache, newIcacheConfig, machineState.icacheConfig, header.icache},
+                  {dcache, newDcacheConfig, machineState.dcacheConfig, header.dcache}};
+    for (auto &l1 : caches)
+    {
+        if (archOnly) break;
+        bool same = sameCacheConfig(l1.savedConfig, l1.config);
+        Cache *saved = same ? nullptr : new Cache{l1.savedConfig, mainMem};
+        Cache *target = same ? l1.cache : saved;
+        if (target->checkpointSize() != l1.section.size)
+        {
+            ret = -EINVAL;
+        }
+        else
+        {
+            target->loadCheckpoint(image + l1.section.offset);
+            if (saved) saved->drain();
+        }
+        delete saved;
+    }
+    munmap(const_cast<uint8_t *>(image), size);
+
+    if (ret)
+    {
+        cout << "Checkpoint file " << fileName << " is damaged" << endl;
+        release();
+        return ret;
+    }
+
+    // the pipeline init left empty picks up at the pc, with the registers as they were
+    if (archOnly)
+    {
+        memcpy(regs, archState.regs, sizeof(regs));
+        regs[0] = 0;
+        pc = archState.pc;
+        return 0;
+    }
+
+    memcpy(regs, machineState.regs, sizeof(regs));
+    memcpy(regReadyCycle, machineState.regReadyCycle, sizeof(regReadyCycle));
+    pipeState = machineState.pipeState;
+    pc = machineState.pc;
+    ifid = machineState.ifid;
+    idex = machineState.idex;
+    exmem = machineState.exmem;
+    memwb = machineState.memwb;
+    haltSeen = machineState.haltSeen;
+    fetchHaltCycles = machineState.fetchHaltCycles;
+    memHaltCycles = machineState.memHaltCycles;
+    lastPcFetch = machineState.lastPcFetch;
+    lastInstructionFetch = machineState.lastInstructionFetch;
+    cycleStatus = static_cast<CycleStatus>(machineState.cycleStatus);
+    simStats = machineState.simStats;
+    retiredInstructions = machineState.retiredInstructions;
+    return 0;
+}
+
+// every access of the trace is made again, in order, before the first cycle. the trace comes from a
+// run that has already left memory as it is now, so a write stores what memory holds and the caches
+// never disagree with it. the counts start from zero afterwards
+int Simulator::Machine::warmCaches(const char *fileName)
+{
+    if (!icache)
+    {
+        cout << "No simulation to warm" << endl;
+        return -EINVAL;
+    }
+    if (!icache->canCheckpoint() || !dcache->canCheckpoint() || !lowerCaches.empty())
+    {
+        cout << "Only L1 caches without MSHRs, prefetchers, victim caches or write buffers can be warmed" << endl;
+        return -EINVAL;
+    }
+
+    TraceReader warmTrace;
+    if (warmTrace.open(fileName))
+    {
+        return -EBADF;
+    }
+
+    // the trace is stamped in instructions, so it runs on a clock of its own, as replay_driver runs
+    // such a trace: a miss is waited out and made again, so each access finds its block filled and
+    // touches it, as the pipeline's would
+    uint32_t warmCycle = 0;
+    TraceRecord record;
+    while (warmTrace.next(record))
+    {
+        Cache *cache = record.kind == TRACE_FETCH ? icache : dcache;
+        MemEntrySize size = static_cast<MemEntrySize>(record.size);
+        uint32_t value = 0;
+        if (record.kind == TRACE_WRITE)
+        {
+            memStore->getMemValue(record.address, value, size);
+        }
+        auto access = [&](uint32_t cycle) {
+            return record.kind == TRACE_WRITE ? cache->setCacheValue(record.address, value, size, cycle)
+                                              : cache->getCacheValue(record.address, value, size, cycle);
+        };
+        if (int delay = access(warmCycle))
+        {
+            warmCycle += delay;
+            access(warmCycle);
+        }
+        warmCycle++;
+    }
+    // that clock ran before the pipeline's first cycle, so nothing it filled is still arriving then
+    icache->settleBlocks();
+    dcache->settleBlocks();
+    icache->clearStats();
+    dcache->clearStats();
+    return warmTrace.isTruncated() ? -EINVAL : 0;
+}
+
+Simulator::Simulator() : machine(new Machine) {}
+
+Simulator::~Simulator()
+{
+    machine->release();
+    delete machine;
+}
+
+int Simulator::init(CacheConfig &icConfig, CacheConfig &dcConfig, MemoryStore *mainMem)
+{
+    return machine->init(icConfig, dcConfig, nullptr, 0, mainMem);
+}
+
+int Simulator::init(CacheConfig &icConfig, CacheConfig &dcConfig, CacheConfig *lowerConfigs,
+                    uint32_t numLevels, MemoryStore *mainMem)
+{
+    return machine->init(icConfig, dcConfig, lowerConfigs, numLevels, mainMem);
+}
+
+int Simulator::initBranchPredictor(BranchPredictorConfig &bpConfig)
+{
+    return machine->initBranchPredictor(bpConfig);
+}
+
+int Simulator::initCacheAnalysis(CacheAnalysisConfig &analysisConfig)
+{
+    return machine->initCacheAnalysis(analysisConfig);
+}
+
+int Simulator::initTrace(const char *fileName)
+{
+    return machine->initTrace(fileName);
+}
+
+int Simulator::runCycles(uint32_t cycles)
+{
+    return machine->runCycles(cycles);
+}
+
+int Simulator::runTillHalt()
+{
+    return machine->runTillHalt();
+}
+
+int Simulator::runInstructions(uint64_t instructions)
+{
+    return machine->runInstructions(instructions);
+}
+
+uint64_t Simulator::getRetiredInstructions()
+{
+    return machine->retiredInstructions;
+}
+
+PipeState Simulator::getPipeState()
+{
+    return machine->pipeState;
+}
+
+SimulationStats Simulator::getStats()
+{
+    return machine->getStats();
+}
+
+int Simulator::checkpoint(const char *fileName)
+{
+    return machine->checkpoint(fileName);
+}
+
+int Simulator::restore(const char *fileName, MemoryStore *mainMem)
+{
+    return machine->restore(fileName, nullptr, nullptr, mainMem);
+}
+
+int Simulator::restore(const char *fileName, CacheConfig &icConfig, CacheConfig &dcConfig, MemoryStore *mainMem)
+{
+    return machine->restore(fileName, &icConfig, &dcConfig, mainMem);
+}
+
+int Simulator::warmCaches(const char *fileName)
+{
+    return machine->warmCaches(fileName);
+}
+
+void Simulator::setReportDirectory(const string &directory)
+{
+    machine->reportDirectory = directory;
+}
+
+int Simulator::finalize()
+{
+    return machine->finalize();
+}
+
+// the driver functions all work on this one
+static Simulator simulator;
+
+// pipeState already counts the cycle after the last one run
+static void dumpLastCycle()
+{
+    PipeState state = simulator.getPipeState();
+    state.cycle--;
+    dumpPipeState(state);
+}
+
+int initSimulator(CacheConfig &icConfig, CacheConfig &dcConfig, MemoryStore *mainMem)
+{
+    return simulator.init(icConfig, dcConfig, mainMem);
+}
+
+int initSimulator(CacheConfig &icConfig, CacheConfig &dcConfig, CacheConfig *lowerConfigs,
+                  uint32_t numLevels, MemoryStore *mainMem)
+{
+    return simulator.init(icConfig, dcConfig, lowerConfigs, numLevels, mainMem);
+}
+
+int initBranchPredictor(BranchPredictorConfig &bpConfig)
+{
+    return simulator.initBranchPredictor(bpConfig);
+}
+
+int initCacheAnalysis(CacheAnalysisConfig &analysisConfig)
+{
+    return simulator.initCacheAnalysis(analysisConfig);
+}
+
+int initTrace(const char *fileName)
+{
+    return simulator.initTrace(fileName);
+}
+
+// the command-line drivers have always stopped outright on an instruction the pipeline cannot run
+int runCycles(uint32_t cycles)
+{
+    int halted = simulator.runCycles(cycles);
+    if (halted < 0) exit(1);
+    dumpLastCycle();
+    return halted;
+}
+
+int runTillHalt()
+{
+    if (simulator.runTillHalt() < 0) exit(1);
+    dumpLastCycle();
+    return 0;
+}
+
+int saveCheckpoint(const char *fileName)
+{
+    return simulator.checkpoint(fileName);
+}
+
+int initSimulatorFromCheckpoint(const char *fileName, MemoryStore *mainMem)
+{
+    return simulator.restore(fileName, mainMem);
+}
+
+int initSimulatorFromCheckpoint(const char *fileName, CacheConfig &icConfig, CacheConfig &dcConfig, MemoryStore *mainMem)
+{
+    return simulator.restore(fileName, icConfig, dcConfig, mainMem);
+}
+
+int warmCaches(const char *fileName)
+{
+    return simulator.warmCaches(fileName);
+}
+
+int finalizeSimulator()
+{
+    return simulator.finalize();
+}
+
+bool parseCacheType(const char *name, CacheConfig &config)
+{
+    size_t length = strlen(name);
+    config.associativity = 0;
+    if (strcmp(name, "direct") == 0)
+    {
+        config.type = DIRECT_MAPPED;
+    }
+    else if (strcmp(name, "2way") == 0)
+    {
+        config.type = TWO_WAY_SET_ASSOC;
+    }
+    else if (strcmp(name, "full") == 0)
+    {
+        config.type = FULLY_ASSOC;
+    }
+    else if (length > 3 && strcmp(name + length - 3, "way") == 0 && atoi(name) > 0)
+    {
+        config.type = SET_ASSOC;
+        config.associativity = atoi(name);
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
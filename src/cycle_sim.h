@@ -0,0 +1,52 @@
+#include <string>
+
+//One cycle-accurate pipeline, with its own registers, caches and predictor. Simulators share
+//no state, so several can run in one process, each driven by one thread at a time. The driver
+//functions in DriverFunctions.h all work on a single process-wide Simulator. Include after
+//DriverFunctions.h.
+class Simulator
+{
+    public:
+        Simulator();
+        ~Simulator();
+        Simulator(const Simulator &) = delete;
+        Simulator & operator=(const Simulator &) = delete;
+
+        //As initSimulator, initBranchPredictor, initCacheAnalysis and initTrace.
+        int init(CacheConfig & icConfig, CacheConfig & dcConfig, MemoryStore *mainMem);
+        int init(CacheConfig & icConfig, CacheConfig & dcConfig, CacheConfig *lowerConfigs,
+                 uint32_t numLevels, MemoryStore *mainMem);
+        int initBranchPredictor(BranchPredictorConfig & bpConfig);
+        int initCacheAnalysis(CacheAnalysisConfig & analysisConfig);
+        int initTrace(const char *fileName);
+        //As runCycles and runTillHalt, without dumping the pipe state. An instruction the pipeline
+        //cannot execute stops the simulator for good and returns -EINVAL, where the driver
+        //functions exit the process.
+        int runCycles(uint32_t cycles);
+        int runTillHalt();
+        //As runCycles, until that many more instructions have left writeback. Squashed
+        //instructions and bubbles do not count.
+        int runInstructions(uint64_t instructions);
+        //Instructions retired since init. A checkpoint carries its count on; a fast-forward
+        //handoff starts from zero.
+        uint64_t getRetiredInstructions();
+        //The pipe state after the last cycle run. Its cycle already counts the next one.
+        PipeState getPipeState();
+        //The statistics finalize prints, between init and finalize.
+        SimulationStats getStats();
+        //As saveCheckpoint, initSimulatorFromCheckpoint and warmCaches.
+        int checkpoint(const char *fileName);
+        int restore(const char *fileName, MemoryStore *mainMem);
+        int restore(const char *fileName, CacheConfig & icConfig, CacheConfig & dcConfig, MemoryStore *mainMem);
+        int warmCaches(const char *fileName);
+        //Where finalize writes sim_stats.out, reg_state.out, mem_state.out and cache_curve.out.
+        //The directory must exist. Left unset, they go to the working directory as
+        //finalizeSimulator's do; simulators given different directories can finalize together.
+        void setReportDirectory(const std::string & directory);
+        //As finalizeSimulator. The caches are freed either way when the simulator is destroyed.
+        int finalize();
+
+    private:
+        struct Machine;
+        Machine *machine;
+};
@@ -0,0 +1,101 @@
+#include "CacheConfig.h"
+#include "prefetcher.h"
+
+#define STRIDE_TABLE_SIZE 64
+#define STRIDE_CONFIDENT 2
+#define STREAM_COUNT 8
+// how many blocks past the end of a stream a trigger can be and still extend it
+#define STREAM_WINDOW 4
+
+NextLinePrefetcher::NextLinePrefetcher(uint32_t blockSize, uint32_t degree, uint32_t distance)
+    : blockSize(blockSize), degree(degree), distance(distance) {}
+
+void NextLinePrefetcher::train(uint32_t address, uint32_t /* pc */, bool trigger, vector<uint32_t> &candidates) {
+    if (!trigger) return;
+    uint32_t block = address / blockSize;
+    for (uint32_t i = 0; i < degree; i++) {
+        candidates.push_back((block + distance + i) * blockSize);
+    }
+}
+
+StridePrefetcher::StridePrefetcher(uint32_t blockSize, uint32_t degree, uint32_t distance)
+    : table(STRIDE_TABLE_SIZE, StrideEntry{}), blockSize(blockSize), degree(degree), distance(distance) {}
+
+void StridePrefetcher::train(uint32_t address, uint32_t pc, bool /* trigger */, vector<uint32_t> &candidates) {
+    StrideEntry &entry = table[(pc >> 2) % STRIDE_TABLE_SIZE];
+    if (entry.pc != pc) {
+        entry = StrideEntry{pc, address, 0, 0};
+        return;
+    }
+
+    int32_t stride = address - entry.lastAddress;
+    entry.lastAddress = address;
+    if (stride == 0) return;
+    if (stride == entry.stride) {
+        if (entry.confidence < STRIDE_CONFIDENT) entry.confidence++;
+    } else {
+        entry.stride = stride;
+        entry.confidence = 0;
+        return;
+    }
+
+    if (entry.confidence < STRIDE_CONFIDENT - 1) return;
+    // strides shorter than a block would name the same block several times
+    uint32_t lastBlock = address / blockSize;
+    for (uint32_t i = 0; i < degree; i++) {
+        uint32_t target = address + stride * (int32_t) (distance + i);
+        if (target / blockSize == lastBlock) continue;
+        lastBlock = target / blockSize;
+        candidates.push_back(target);
+    }
+}
+
+StreamPrefetcher::StreamPrefetcher(uint32_t blockSize, uint32_t degree, uint32_t distance)
+    : streams(STREAM_COUNT, Stream{}), clock(0), blockSize(blockSize), degree(degree), distance(distance) {}
+
+void StreamPrefetcher::train(uint32_t address, uint32_t /* pc */, bool trigger, vector<uint32_t> &candidates) {
+    if (!trigger) return;
+    uint32_t block = address / blockSize;
+    clock++;
+
+    Stream *oldest = &streams[0];
+    for (Stream &stream : streams) {
+        if (!stream.valid) {
+            if (oldest->valid) oldest = &stream;
+            continue;
+        }
+        if (oldest->valid && stream.lastUse < oldest->lastUse) oldest = &stream;
+
+        int32_t step = block - stream.lastBlock;
+        int32_t direction = step > 0 ? 1 : -1;
+        if (step == 0 || step * direction > STREAM_WINDOW) continue;
+        if (stream.direction != 0 && direction != stream.direction) continue;
+
+        // the second trigger of a run fixes its direction, the ones after that fetch ahead
+        bool confirmed = stream.direction != 0;
+        stream.direction = direction;
+        stream.lastBlock = block;
+        stream.lastUse = clock;
+        if (!confirmed) return;
+        for (uint32_t i = 0; i < degree; i++) {
+            candidates.push_back((block + direction * (int32_t) (distance + i)) * blockSize);
+        }
+        return;
+    }
+
+    *oldest = Stream{true, block, 0, clock};
+}
+
+Prefetcher *createPrefetcher(PrefetcherType type, uint32_t blockSize, uint32_t degree, uint32_t distance) {
+    switch (type) {
+        case NEXT_LINE_PREFETCH:
+            return new NextLinePrefetcher(blockSize, degree, distance);
+        case STRIDE_PREFETCH:
+            return new StridePrefetcher(blockSize, degree, distance);
+        case STREAM_PREFETCH:
+            return new StreamPrefetcher(blockSize, degree, distance);
+        case NO_PREFETCH:
+        default:
+            return nullptr;
+    }
+}
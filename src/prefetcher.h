@@ -0,0 +1,61 @@
+#include <inttypes.h>
+#include <vector>
+
+using std::vector;
+
+// Watches an L1 cache's demand accesses and names blocks to fetch before they are asked for.
+// The cache does the fetching, skipping blocks it already holds.
+class Prefetcher {
+    public:
+        virtual ~Prefetcher() {}
+        // a demand access to address by the instruction at pc. trigger is set for a miss or the
+        // first use of a prefetched block. appends the addresses to prefetch to candidates
+        virtual void train(uint32_t address, uint32_t pc, bool trigger, vector<uint32_t> &candidates) = 0;
+};
+
+// on each trigger, fetches degree blocks starting distance blocks past the accessed one
+class NextLinePrefetcher : public Prefetcher {
+    private:
+        uint32_t blockSize, degree, distance;
+    public:
+        NextLinePrefetcher(uint32_t blockSize, uint32_t degree, uint32_t distance);
+        void train(uint32_t address, uint32_t pc, bool trigger, vector<uint32_t> &candidates);
+};
+
+// reference prediction table: per load PC, the last address and stride. once the same stride
+// has been seen twice in a row, fetches degree strides starting distance strides ahead
+class StridePrefetcher : public Prefetcher {
+    private:
+        struct StrideEntry {
+            uint32_t pc;
+            uint32_t lastAddress;
+            int32_t stride;
+            uint32_t confidence;
+        };
+        vector<StrideEntry> table;
+        uint32_t blockSize, degree, distance;
+    public:
+        StridePrefetcher(uint32_t blockSize, uint32_t degree, uint32_t distance);
+        void train(uint32_t address, uint32_t pc, bool trigger, vector<uint32_t> &candidates);
+};
+
+// follows a few runs of triggering blocks. a trigger just past the end of a run, in either
+// direction, extends it and fetches degree blocks starting distance blocks further on
+class StreamPrefetcher : public Prefetcher {
+    private:
+        struct Stream {
+            bool valid;
+            uint32_t lastBlock;
+            int32_t direction;
+            uint64_t lastUse;
+        };
+        vector<Stream> streams;
+        uint64_t clock;
+        uint32_t blockSize, degree, distance;
+    public:
+        StreamPrefetcher(uint32_t blockSize, uint32_t degree, uint32_t distance);
+        void train(uint32_t address, uint32_t pc, bool trigger, vector<uint32_t> &candidates);
+};
+
+// nullptr for NO_PREFETCH
+Prefetcher *createPrefetcher(PrefetcherType type, uint32_t blockSize, uint32_t degree, uint32_t distance);
@@ -1,11 +1,22 @@
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <vector>
 #include <string.h>
 #include <errno.h>
 #include "MemoryStore.h"
+#include "FlatMemoryStore.h"
+#include "ProgramLoader.h"
 #include "RegisterInfo.h"
 #include "EndianHelpers.h"
+#include "TraceFile.h"
+#include "SnapshotFile.h"
+#include "SimPoint.h"
+
+#if defined(__x86_64__) && defined(__unix__)
+#include <sys/mman.h>
+#define HAVE_JIT 1
+#endif
 
 #define MAGIC_DEMARC 0xfeedfeed
 #define EXCEPTION_ADDR 0x8000
@@ -68,6 +79,8 @@ enum OP_IDS
     OP_ANDI = 0xc,
     OP_BEQ = 0x4,
     OP_BNE = 0x5,
+    OP_BLEZ = 0x6,
+    OP_BGTZ = 0x7,
     OP_LBU = 0x24,
     OP_LHU = 0x25,
     OP_LL = 0x30,
@@ -106,40 +119,41 @@ using namespace std;
 //Static global variables...
 static uint32_t progCounter;
 static uint32_t regs[NUM_REGS];
-static MemoryStore *mem;
+//Held as a FlatMemoryStore so every access binds to it statically.
+static FlatMemoryStore *mem;
 
 static bool ll_sc_flag;
 static uint32_t ll_sc_addr;
 
-int initMemory(ifstream & inputProg)
-{
-    if(inputProg && mem)
-    {
-        uint32_t curVal = 0;
-        uint32_t addr = 0;
+//Set by --trace: every fetch and data access of the reference interpreter goes to it, each with
+//the number of the instruction making it, counting from 1.
+static TraceWriter *trace;
+static uint64_t instructionsRun;
 
-        while(inputProg.read((char *)(&curVal), sizeof(uint32_t)))
-        {
-            curVal = ConvertWordToBigEndian(curVal);
-            int ret = mem->setMemValue(addr, curVal, WORD_SIZE);
+//Set by --fast-forward and --until-pc: the reference interpreter stops before the first
+//instruction past stopAfter of them, or at stopPC, whichever comes first. A branch and its delay
+//slot run together, so it never stops in between.
+static uint64_t stopAfter = UINT64_MAX;
+static uint32_t stopPC = UINT32_MAX;
 
-            if(ret)
-            {
-                cout << "Could not set memory value!" << endl;
-                return -EINVAL;
-            }
+//Set by --simpoints while profiling: each step of the reference interpreter goes to it.
+static BasicBlockProfile *blockProfile;
 
-            //We're reading 4 bytes each time...
-            addr += 4;
-        }
-    }
-    else
+inline void traceFetch(uint32_t pc)
+{
+    instructionsRun++;
+    if(trace)
     {
-        cout << "Invalid file stream or memory image passed, could not initialise memory values" << endl;
-        return -EINVAL;
+        trace->record(TRACE_FETCH, pc, WORD_SIZE, instructionsRun);
     }
+}
 
-    return 0;
+inline void traceData(TraceKind kind, uint32_t addr, MemEntrySize size)
+{
+    if(trace)
+    {
+        trace->record(kind, addr, size, instructionsRun);
+    }
 }
 
 //Byte's the smallest thing that can hold the opcode...
@@ -285,6 +299,7 @@ int doLoad(uint32_t addr, MemEntrySize size, uint8_t rt)
 {
     uint32_t value = 0;
     int ret = 0;
+    traceData(TRACE_READ, addr, size);
     ret = mem->getMemValue(addr, value, size);
     if(ret)
     {
@@ -381,6 +396,21 @@ int handleImmInst(uint32_t instr)
                 ret = NOINC_PC;
             }
             break;
+        case OP_BLEZ:
+            //These two compare rs, as a signed value, against zero.
+            if(static_cast<int32_t>(regs[rs]) <= 0)
+            {
+                progCounter += 4 + ((static_cast<int32_t>(seImm)) << 2);
+                ret = NOINC_PC;
+            }
+            break;
+        case OP_BGTZ:
+            if(static_cast<int32_t>(regs[rs]) > 0)
+            {
+                progCounter += 4 + ((static_cast<int32_t>(seImm)) << 2);
+                ret = NOINC_PC;
+            }
+            break;
         case OP_LBU:
             ret = doLoad(addr, BYTE_SIZE, rt);
             break;
@@ -410,6 +440,7 @@ int handleImmInst(uint32_t instr)
             regs[rt] = (regs[rs] < static_cast<uint32_t>(seImm)) ? 1 : 0;
             break;
         case OP_SB:
+            traceData(TRACE_WRITE, addr, BYTE_SIZE);
             ret = mem->setMemValue(addr, regs[rt] & 0xFF, BYTE_SIZE);
             checkLLSCOverlap(addr, BYTE_SIZE);
             break;
@@ -419,6 +450,7 @@ int handleImmInst(uint32_t instr)
                 if(ll_sc_flag)
                 {
                     //We are atomic. Store the value.
+                    traceData(TRACE_WRITE, addr, WORD_SIZE);
                     ret = mem->setMemValue(addr, regs[rt], WORD_SIZE);
                 }
 
@@ -431,10 +463,12 @@ int handleImmInst(uint32_t instr)
             ll_sc_flag = false;
             break;
         case OP_SH:
+            traceData(TRACE_WRITE, addr, HALF_SIZE);
             ret = mem->setMemValue(addr, regs[rt] & 0xFFFF, HALF_SIZE);
             checkLLSCOverlap(addr, HALF_SIZE);
             break;
         case OP_SW:
+            traceData(TRACE_WRITE, addr, WORD_SIZE);
             ret = mem->setMemValue(addr, regs[rt], WORD_SIZE);
             checkLLSCOverlap(addr, WORD_SIZE);
             break;
@@ -500,6 +534,7 @@ int runInstruction(uint32_t curInst, bool isDelayInst);
 int runDelayInstruction(uint32_t delayPC, int succRet)
 {
     uint32_t delayInst = 0;
+    traceFetch(delayPC);
     int ret = mem->getMemValue(delayPC, delayInst, WORD_SIZE);
     if(ret)
     {
@@ -518,9 +553,11 @@ int runDelayInstruction(uint32_t delayPC, int succRet)
 
 int runInstruction(uint32_t curInst)
 {
-    runInstruction(curInst, false);
+    return runInstruction(curInst, false);
 }
 
+int finishInstruction(int ret, bool isDelayInst);
+
 int runInstruction(uint32_t curInst, bool isDelayInst)
 {
     int ret = 0;
@@ -536,6 +573,8 @@ int runInstruction(uint32_t curInst, bool isDelayInst)
         case OP_ANDI:
         case OP_BEQ:
         case OP_BNE:
+        case OP_BLEZ:
+        case OP_BGTZ:
         case OP_LBU:
         case OP_LHU:
         case OP_LL:
@@ -565,6 +604,12 @@ int runInstruction(uint32_t curInst, bool isDelayInst)
             break;
     }
 
+    return finishInstruction(ret, isDelayInst);
+}
+
+//Takes the return value of one of the handle* functions and updates the PC for it.
+int finishInstruction(int ret, bool isDelayInst)
+{
     if(ret == NOINC_PC)
     {
         //Don't increment the PC.
@@ -645,12 +690,14 @@ void fillRegisterState(RegisterInfo & reg)
 //execution, so there should be no problem with stale values, etc.
 int runProgram()
 {
-    while(true)
+    while(instructionsRun < stopAfter && progCounter != stopPC)
     {
         uint32_t curInst = 0;
         //Store the current PC for printing out errors...
         uint32_t curPC = progCounter;
+        uint64_t instructionsBefore = instructionsRun;
 
+        traceFetch(progCounter);
         if(mem->getMemValue(progCounter, curInst, WORD_SIZE))
         {
             return -EBADF;
@@ -673,6 +720,11 @@ int runProgram()
             return -EINVAL;
         }
 
+        if(blockProfile)
+        {
+            blockProfile->count(curPC, instructionsRun - instructionsBefore, instructionsRun);
+        }
+
         //Dump the state of the system after every instruction for debugging purposes.
         //Commented out by default.
         /*cout << endl;
@@ -687,37 +739,1283 @@ int runProgram()
         //The PC will be appropriately set by runInstruction.
         //We don't have to do anything here.
     }
+
+    return 0;
 }
 
-int main(int argc, char *argv[])
+//The translated engine. Each word of memory is decoded once into a handler with its fields
+//already extracted, and runs from that until a store writes over it. Every handler does exactly
+//what its handle* function does for that one instruction, delay slots, exceptions and error
+//messages included, so the two engines always end in the same state.
+
+struct TranslatedInst;
+typedef int (*InstHandler)(const TranslatedInst & inst);
+
+struct TranslatedInst
+{
+    //nullptr until the word is translated, and again once a store overwrites it.
+    InstHandler handler;
+    uint32_t instr;
+    uint8_t rs;
+    uint8_t rt;
+    uint8_t rd;
+    uint8_t shamt;
+    uint16_t imm;
+    uint32_t seImm;
+    //Jump target field, for J and JAL.
+    uint32_t addr;
+};
+
+static TranslatedInst translations[MEMORY_SIZE / WORD_SIZE];
+
+//The block engine. A block is the straight-line run of translated instructions from one PC to
+//the first branch or jump and its delay slot, copied out of translations so it runs as one
+//unit. Each way out remembers the block it led to last time, so a hot loop goes block to block
+//without looking anything up.
+#define BLOCK_MAX_INSTS 64
+
+//Native code for the start of a block, see compileNative. Runs straight on the register file
+//and returns how many instructions it finished.
+typedef uint32_t (*NativeBlock)(uint32_t *regFile);
+
+struct TranslatedBlock
+{
+    bool valid;
+    uint32_t startPC;
+    //The PC after the last instruction, where an untaken branch leaves the block.
+    uint32_t fallThroughPC;
+    vector<TranslatedInst> insts;
+    //The blocks last run after this one. Only followed while they are valid and still start
+    //where the PC is going.
+    TranslatedBlock *taken;
+    TranslatedBlock *fallThrough;
+    //With --jit: times run so far, and once hot, native code for its first nativeInsts
+    //instructions.
+    uint32_t runs;
+    NativeBlock native;
+    uint32_t nativeInsts;
+};
+
+//Indexed by the word a block starts at. A block keeps its slot when invalidated, and is
+//rebuilt in place, so the links to it stay good.
+static TranslatedBlock *blocks[MEMORY_SIZE / WORD_SIZE];
+//Words some block has copied.
+static bool blockCode[MEMORY_SIZE / WORD_SIZE];
+//Set when a store invalidates a block, so the running block stops before its next instruction.
+static bool blockInvalidated;
+
+//Any block holding the word starts at most BLOCK_MAX_INSTS - 1 words before it.
+void invalidateBlocks(uint32_t word)
 {
-    if(argc != 2)
+    blockCode[word] = false;
+    uint32_t first = (word >= BLOCK_MAX_INSTS - 1) ? word - (BLOCK_MAX_INSTS - 1) : 0;
+    for(uint32_t start = first; start <= word; start++)
     {
-        cout << "Usage: ./sim <file name>" << endl;
-        return -EINVAL;
+        TranslatedBlock *block = blocks[start];
+        if(block && block->valid && start + block->insts.size() > word)
+        {
+            block->valid = false;
+            blockInvalidated = true;
+        }
+    }
+}
+
+void translateInstruction(uint32_t instr, TranslatedInst & inst);
+
+int getTranslation(uint32_t pc, const TranslatedInst *& inst)
+{
+    TranslatedInst & entry = translations[pc / WORD_SIZE];
+    if(!entry.handler)
+    {
+        uint32_t instr = 0;
+        int ret = mem->getMemValue(pc, instr, WORD_SIZE);
+        if(ret)
+        {
+            return ret;
+        }
+        translateInstruction(instr, entry);
+    }
+
+    inst = &entry;
+    return 0;
+}
+
+//Self-modifying code: drop the translations of every word a store touched.
+void invalidateTranslations(uint32_t addr, MemEntrySize size)
+{
+    for(uint32_t word = addr / WORD_SIZE; word <= (addr + size - 1) / WORD_SIZE; word++)
+    {
+        if(word < MEMORY_SIZE / WORD_SIZE)
+        {
+            translations[word].handler = nullptr;
+            if(blockCode[word])
+            {
+                invalidateBlocks(word);
+            }
+        }
     }
+}
 
-    ifstream prog;
-    prog.open(argv[1], ios::binary | ios::in);
+//As runDelayInstruction, for the delay slot of a translated branch.
+int runTranslatedDelay(uint32_t delayPC)
+{
+    if(delayPC % WORD_SIZE != 0 || delayPC >= MEMORY_SIZE)
+    {
+        return runDelayInstruction(delayPC, NOINC_PC);
+    }
 
-    mem = createMemoryStore();
+    const TranslatedInst *delayInst;
+    int ret = getTranslation(delayPC, delayInst);
+    if(ret)
+    {
+        return ret;
+    }
 
-    if(initMemory(prog))
+    ret = finishInstruction(delayInst->handler(*delayInst), true);
+    if(ret)
     {
-        return -EBADF;
+        return ret;
     }
 
-    for(int i = 0 ; i < NUM_REGS ; i++)
+    return NOINC_PC;
+}
+
+//Every handler ends like the handle* functions: the zero register is reset, and an instruction
+//that moved the PC runs its delay slot.
+int endTranslated(int ret, uint32_t oldPC)
+{
+    regs[REG_ZERO] = 0;
+
+    if(ret == NOINC_PC)
     {
-        //This'll initialise the zero register appropriately too...
-        regs[i] = 0;
+        return runTranslatedDelay(oldPC + 4);
     }
 
-    //Run the program...
-    progCounter = 0;
+    return ret;
+}
+
+int execAdd(const TranslatedInst & inst)
+{
+    return endTranslated(doAddSub(inst.rd, regs[inst.rs], regs[inst.rt], true, true), progCounter);
+}
+
+int execAddu(const TranslatedInst & inst)
+{
+    return endTranslated(doAddSub(inst.rd, regs[inst.rs], regs[inst.rt], true, false), progCounter);
+}
+
+int execAnd(const TranslatedInst & inst)
+{
+    regs[inst.rd] = regs[inst.rs] & regs[inst.rt];
+    return endTranslated(0, progCounter);
+}
+
+int execJr(const TranslatedInst & inst)
+{
+    uint32_t oldPC = progCounter;
+    progCounter = regs[inst.rs];
+    return endTranslated(NOINC_PC, oldPC);
+}
+
+int execNor(const TranslatedInst & inst)
+{
+    regs[inst.rd] = ~(regs[inst.rs] | regs[inst.rt]);
+    return endTranslated(0, progCounter);
+}
+
+int execOr(const TranslatedInst & inst)
+{
+    regs[inst.rd] = regs[inst.rs] | regs[inst.rt];
+    return endTranslated(0, progCounter);
+}
+
+int execSlt(const TranslatedInst & inst)
+{
+    regs[inst.rd] = (static_cast<int32_t>(regs[inst.rs]) < static_cast<int32_t>(regs[inst.rt])) ? 1 : 0;
+    return endTranslated(0, progCounter);
+}
+
+int execSltu(const TranslatedInst & inst)
+{
+    regs[inst.rd] = (regs[inst.rs] < regs[inst.rt]) ? 1 : 0;
+    return endTranslated(0, progCounter);
+}
+
+int execSll(const TranslatedInst & inst)
+{
+    regs[inst.rd] = regs[inst.rt] << inst.shamt;
+    return endTranslated(0, progCounter);
+}
+
+int execSrl(const TranslatedInst & inst)
+{
+    regs[inst.rd] = regs[inst.rt] >> inst.shamt;
+    return endTranslated(0, progCounter);
+}
+
+int execSub(const TranslatedInst & inst)
+{
+    return endTranslated(doAddSub(inst.rd, regs[inst.rs], regs[inst.rt], false, true), progCounter);
+}
+
+int execSubu(const TranslatedInst & inst)
+{
+    return endTranslated(doAddSub(inst.rd, regs[inst.rs], regs[inst.rt], false, false), progCounter);
+}
+
+//An unknown opcode, or a zero opcode with an unknown function. Both print the same message.
+int execIllegal(const TranslatedInst & inst)
+{
+    cerr << "Illegal instruction at address " << "0x" << hex
+         << setfill('0') << setw(8) << progCounter << endl;
+    regs[REG_ZERO] = 0;
+    return ILLEGAL_INST;
+}
+
+uint32_t translatedAddr(const TranslatedInst & inst)
+{
+    return static_cast<uint32_t>(static_cast<int32_t>(regs[inst.rs]) + static_cast<int32_t>(inst.seImm));
+}
+
+int execAddi(const TranslatedInst & inst)
+{
+    return endTranslated(doAddSub(inst.rt, regs[inst.rs], inst.seImm, true, true), progCounter);
+}
+
+int execAddiu(const TranslatedInst & inst)
+{
+    return endTranslated(doAddSub(inst.rt, regs[inst.rs], inst.seImm, true, false), progCounter);
+}
+
+int execAndi(const TranslatedInst & inst)
+{
+    regs[inst.rt] = regs[inst.rs] & inst.imm;
+    return endTranslated(0, progCounter);
+}
+
+int execBeq(const TranslatedInst & inst)
+{
+    uint32_t oldPC = progCounter;
+    if(regs[inst.rs] == regs[inst.rt])
+    {
+        progCounter += 4 + ((static_cast<int32_t>(inst.seImm)) << 2);
+        return endTranslated(NOINC_PC, oldPC);
+    }
+    return endTranslated(0, oldPC);
+}
+
+int execBne(const TranslatedInst & inst)
+{
+    uint32_t oldPC = progCounter;
+    if(regs[inst.rs] != regs[inst.rt])
+    {
+        progCounter += 4 + ((static_cast<int32_t>(inst.seImm)) << 2);
+        return endTranslated(NOINC_PC, oldPC);
+    }
+    return endTranslated(0, oldPC);
+}
+
+int execBlez(const TranslatedInst & inst)
+{
+    uint32_t oldPC = progCounter;
+    if(static_cast<int32_t>(regs[inst.rs]) <= 0)
+    {
+        progCounter += 4 + ((static_cast<int32_t>(inst.seImm)) << 2);
+        return endTranslated(NOINC_PC, oldPC);
+    }
+    return endTranslated(0, oldPC);
+}
+
+int execBgtz(const TranslatedInst & inst)
+{
+    uint32_t oldPC = progCounter;
+    if(static_cast<int32_t>(regs[inst.rs]) > 0)
+    {
+        progCounter += 4 + ((static_cast<int32_t>(inst.seImm)) << 2);
+        return endTranslated(NOINC_PC, oldPC);
+    }
+    return endTranslated(0, oldPC);
+}
+
+int execLbu(const TranslatedInst & inst)
+{
+    return endTranslated(doLoad(translatedAddr(inst), BYTE_SIZE, inst.rt), progCounter);
+}
+
+int execLhu(const TranslatedInst & inst)
+{
+    return endTranslated(doLoad(translatedAddr(inst), HALF_SIZE, inst.rt), progCounter);
+}
+
+int execLl(const TranslatedInst & inst)
+{
+    uint32_t addr = translatedAddr(inst);
+    ll_sc_flag = true;
+    ll_sc_addr = addr;
+    return endTranslated(doLoad(addr, WORD_SIZE, inst.rt), progCounter);
+}
+
+int execLui(const TranslatedInst & inst)
+{
+    regs[inst.rt] = static_cast<uint32_t>(inst.imm) << 16;
+    return endTranslated(0, progCounter);
+}
+
+int execLw(const TranslatedInst & inst)
+{
+    return endTranslated(doLoad(translatedAddr(inst), WORD_SIZE, inst.rt), progCounter);
+}
+
+int execOri(const TranslatedInst & inst)
+{
+    regs[inst.rt] = regs[inst.rs] | inst.imm;
+    return endTranslated(0, progCounter);
+}
+
+int execSlti(const TranslatedInst & inst)
+{
+    regs[inst.rt] = (static_cast<int32_t>(regs[inst.rs]) < static_cast<int32_t>(inst.seImm)) ? 1 : 0;
+    return endTranslated(0, progCounter);
+}
+
+int execSltiu(const TranslatedInst & inst)
+{
+    regs[inst.rt] = (regs[inst.rs] < inst.seImm) ? 1 : 0;
+    return endTranslated(0, progCounter);
+}
+
+int execSb(const TranslatedInst & inst)
+{
+    uint32_t addr = translatedAddr(inst);
+    int ret = mem->setMemValue(addr, regs[inst.rt] & 0xFF, BYTE_SIZE);
+    checkLLSCOverlap(addr, BYTE_SIZE);
+    invalidateTranslations(addr, BYTE_SIZE);
+    return endTranslated(ret, progCounter);
+}
+
+int execSc(const TranslatedInst & inst)
+{
+    uint32_t addr = translatedAddr(inst);
+    int ret = 0;
+    if(addr == ll_sc_addr)
+    {
+        if(ll_sc_flag)
+        {
+            ret = mem->setMemValue(addr, regs[inst.rt], WORD_SIZE);
+            invalidateTranslations(addr, WORD_SIZE);
+        }
+
+        regs[inst.rt] = (ll_sc_flag) ? 1 : 0;
+    }
+    else
+    {
+        regs[inst.rt] = 0;
+    }
     ll_sc_flag = false;
+    return endTranslated(ret, progCounter);
+}
+
+int execSh(const TranslatedInst & inst)
+{
+    uint32_t addr = translatedAddr(inst);
+    int ret = mem->setMemValue(addr, regs[inst.rt] & 0xFFFF, HALF_SIZE);
+    checkLLSCOverlap(addr, HALF_SIZE);
+    invalidateTranslations(addr, HALF_SIZE);
+    return endTranslated(ret, progCounter);
+}
+
+int execSw(const TranslatedInst & inst)
+{
+    uint32_t addr = translatedAddr(inst);
+    int ret = mem->setMemValue(addr, regs[inst.rt], WORD_SIZE);
+    checkLLSCOverlap(addr, WORD_SIZE);
+    invalidateTranslations(addr, WORD_SIZE);
+    return endTranslated(ret, progCounter);
+}
+
+int execJ(const TranslatedInst & inst)
+{
+    uint32_t oldPC = progCounter;
+    progCounter = ((progCounter + 4) & 0xf0000000) | (inst.addr << 2);
+    return endTranslated(NOINC_PC, oldPC);
+}
+
+int execJal(const TranslatedInst & inst)
+{
+    uint32_t oldPC = progCounter;
+    regs[REG_RA] = progCounter + 8;
+    progCounter = ((progCounter + 4) & 0xf0000000) | (inst.addr << 2);
+    return endTranslated(NOINC_PC, oldPC);
+}
+
+InstHandler getOpZeroHandler(uint8_t funct)
+{
+    switch(funct)
+    {
+        case FUN_ADD:
+            return execAdd;
+        case FUN_ADDU:
+            return execAddu;
+        case FUN_AND:
+            return execAnd;
+        case FUN_JR:
+            return execJr;
+        case FUN_NOR:
+            return execNor;
+        case FUN_OR:
+            return execOr;
+        case FUN_SLT:
+            return execSlt;
+        case FUN_SLTU:
+            return execSltu;
+        case FUN_SLL:
+            return execSll;
+        case FUN_SRL:
+            return execSrl;
+        case FUN_SUB:
+            return execSub;
+        case FUN_SUBU:
+            return execSubu;
+        default:
+            return execIllegal;
+    }
+}
 
-    runProgram();
+InstHandler getHandler(uint32_t instr)
+{
+    switch(getOpcode(instr))
+    {
+        case OP_ZERO:
+            return getOpZeroHandler(instr & 0x3f);
+        case OP_ADDI:
+            return execAddi;
+        case OP_ADDIU:
+            return execAddiu;
+        case OP_ANDI:
+            return execAndi;
+        case OP_BEQ:
+            return execBeq;
+        case OP_BNE:
+            return execBne;
+        case OP_BLEZ:
+            return execBlez;
+        case OP_BGTZ:
+            return execBgtz;
+        case OP_LBU:
+            return execLbu;
+        case OP_LHU:
+            return execLhu;
+        case OP_LL:
+            return execLl;
+        case OP_LUI:
+            return execLui;
+        case OP_LW:
+            return execLw;
+        case OP_ORI:
+            return execOri;
+        case OP_SLTI:
+            return execSlti;
+        case OP_SLTIU:
+            return execSltiu;
+        case OP_SB:
+            return execSb;
+        case OP_SC:
+            return execSc;
+        case OP_SH:
+            return execSh;
+        case OP_SW:
+            return execSw;
+        case OP_J:
+            return execJ;
+        case OP_JAL:
+            return execJal;
+        default:
+            //Including MAGIC_DEMARC, which is only the end of the program outside a delay slot.
+            return execIllegal;
+    }
+}
+
+void translateInstruction(uint32_t instr, TranslatedInst & inst)
+{
+    inst.handler = getHandler(instr);
+    inst.instr = instr;
+    inst.rs = (instr >> 21) & 0x1f;
+    inst.rt = (instr >> 16) & 0x1f;
+    inst.rd = (instr >> 11) & 0x1f;
+    inst.shamt = (instr >> 6) & 0x1f;
+    inst.imm = instr & 0xffff;
+    inst.seImm = static_cast<uint32_t>(static_cast<int32_t>(static_cast<int16_t>(inst.imm)));
+    inst.addr = instr & 0x3ffffff;
+}
+
+//As runProgram, dispatching through the translations. A PC off the word grid is fetched and
+//run by runInstruction instead.
+int runTranslatedProgram()
+{
+    while(true)
+    {
+        uint32_t curInst = 0;
+        uint32_t curPC = progCounter;
+        int ret = 0;
+
+        if(progCounter % WORD_SIZE != 0 || progCounter >= MEMORY_SIZE)
+        {
+            if(mem->getMemValue(progCounter, curInst, WORD_SIZE))
+            {
+                return -EBADF;
+            }
+            if(curInst == MAGIC_DEMARC)
+            {
+                break;
+            }
+            ret = runInstruction(curInst);
+        }
+        else
+        {
+            const TranslatedInst *inst;
+            if(getTranslation(progCounter, inst))
+            {
+                return -EBADF;
+            }
+            curInst = inst->instr;
+            if(curInst == MAGIC_DEMARC)
+            {
+                break;
+            }
+            ret = finishInstruction(inst->handler(*inst), false);
+        }
+
+        if(ret)
+        {
+            cerr << "Error executing instruction " << "0x" << hex << setfill('0')
+                 << setw(8) << curInst << " at address " << "0x" << curPC << endl;
+            return -EINVAL;
+        }
+    }
+
+    return 0;
+}
+
+//The JIT. Once a block has run JIT_HOT_RUNS times (with --jit), the longest run of register-only
+//instructions it starts with is compiled to x86-64 that works on regs directly. Loads, stores,
+//branches and anything illegal end the native code; the rest of the block is interpreted as
+//before. The native code returns how many instructions it finished, so an overflowing add or
+//sub leaves through an exit stub returning its own index, and runBlock takes the exception
+//from there with the PC on that instruction. The end of the program never gets this far,
+//since blocks stop before it.
+static bool jitEnabled;
+
+#define JIT_HOT_RUNS 32
+//Not worth a call for less.
+#define JIT_MIN_INSTS 2
+#define JIT_BUFFER_SIZE (1 << 20)
+
+#ifdef HAVE_JIT
+
+//x86 register numbers, and the ModRM byte addressing regs[r] off rdi, the first argument.
+#define X86_EAX 0
+#define X86_ECX 1
+#define REG_DISP_MODRM(x86Reg) (0x47 | ((x86Reg) << 3))
+
+static uint8_t *jitBuffer;
+static uint32_t jitUsed;
+
+void emit32(vector<uint8_t> & code, uint32_t value)
+{
+    for(int i = 0 ; i < 4 ; i++)
+    {
+        code.push_back((value >> (8 * i)) & 0xff);
+    }
+}
+
+//mov x86Reg, [rdi + 4 * reg]
+void emitLoadReg(vector<uint8_t> & code, uint8_t x86Reg, uint8_t reg)
+{
+    code.push_back(0x8b);
+    code.push_back(REG_DISP_MODRM(x86Reg));
+    code.push_back(reg * 4);
+}
+
+//mov [rdi + 4 * reg], eax. Writes to the zero register are dropped, which is what resetting
+//it after the instruction comes to.
+void emitStoreReg(vector<uint8_t> & code, uint8_t reg)
+{
+    if(reg == REG_ZERO)
+    {
+        return;
+    }
+    code.push_back(0x89);
+    code.push_back(REG_DISP_MODRM(X86_EAX));
+    code.push_back(reg * 4);
+}
+
+//mov eax, value; ret
+void emitReturn(vector<uint8_t> & code, uint32_t value)
+{
+    code.push_back(0xb8);
+    emit32(code, value);
+    code.push_back(0xc3);
+}
+
+//The exit stub for an add or sub: jno past it, otherwise return the instruction's index with
+//the destination register untouched.
+void emitOverflowExit(vector<uint8_t> & code, uint32_t index)
+{
+    code.push_back(0x71);
+    code.push_back(6);
+    emitReturn(code, index);
+}
+
+//op eax, ecx for one of the two-register ALU opcodes.
+void emitRegOp(vector<uint8_t> & code, const TranslatedInst & inst, uint8_t op)
+{
+    emitLoadReg(code, X86_EAX, inst.rs);
+    emitLoadReg(code, X86_ECX, inst.rt);
+    code.push_back(op);
+    code.push_back(0xc8);
+}
+
+//op eax, imm32 for one of the immediate ALU opcodes.
+void emitImmOp(vector<uint8_t> & code, const TranslatedInst & inst, uint8_t op, uint32_t imm)
+{
+    emitLoadReg(code, X86_EAX, inst.rs);
+    code.push_back(op);
+    emit32(code, imm);
+}
+
+//setcc al; movzx eax, al, after a cmp.
+void emitSet(vector<uint8_t> & code, uint8_t cond)
+{
+    code.push_back(0x0f);
+    code.push_back(cond);
+    code.push_back(0xc0);
+    code.push_back(0x0f);
+    code.push_back(0xb6);
+    code.push_back(0xc0);
+}
+
+#define X86_ADD 0x01
+#define X86_OR 0x09
+#define X86_AND 0x21
+#define X86_SUB 0x29
+#define X86_CMP 0x39
+#define X86_ADD_IMM 0x05
+#define X86_OR_IMM 0x0d
+#define X86_AND_IMM 0x25
+#define X86_CMP_IMM 0x3d
+#define X86_SETL 0x9c
+#define X86_SETB 0x92
+
+//Appends the native code for one instruction, or returns false if it has to be interpreted.
+bool compileNativeInst(const TranslatedInst & inst, uint32_t index, vector<uint8_t> & code)
+{
+    uint8_t dest = inst.rt;
+
+    switch(getOpcode(inst.instr))
+    {
+        case OP_ZERO:
+            dest = inst.rd;
+            switch(inst.instr & 0x3f)
+            {
+                case FUN_ADD:
+                    emitRegOp(code, inst, X86_ADD);
+                    emitOverflowExit(code, index);
+                    break;
+                case FUN_ADDU:
+                    emitRegOp(code, inst, X86_ADD);
+                    break;
+                case FUN_SUB:
+                    emitRegOp(code, inst, X86_SUB);
+                    emitOverflowExit(code, index);
+                    break;
+                case FUN_SUBU:
+                    emitRegOp(code, inst, X86_SUB);
+                    break;
+                case FUN_AND:
+                    emitRegOp(code, inst, X86_AND);
+                    break;
+                case FUN_OR:
+                    emitRegOp(code, inst, X86_OR);
+                    break;
+                case FUN_NOR:
+                    //or, then not eax
+                    emitRegOp(code, inst, X86_OR);
+                    code.push_back(0xf7);
+                    code.push_back(0xd0);
+                    break;
+                case FUN_SLT:
+                    emitRegOp(code, inst, X86_CMP);
+                    emitSet(code, X86_SETL);
+                    break;
+                case FUN_SLTU:
+                    emitRegOp(code, inst, X86_CMP);
+                    emitSet(code, X86_SETB);
+                    break;
+                case FUN_SLL:
+                case FUN_SRL:
+                    //shl/shr eax, shamt
+                    emitLoadReg(code, X86_EAX, inst.rt);
+                    code.push_back(0xc1);
+                    code.push_back(((inst.instr & 0x3f) == FUN_SLL) ? 0xe0 : 0xe8);
+                    code.push_back(inst.shamt);
+                    break;
+                default:
+                    return false;
+            }
+            break;
+        case OP_ADDI:
+            emitImmOp(code, inst, X86_ADD_IMM, inst.seImm);
+            emitOverflowExit(code, index);
+            break;
+        case OP_ADDIU:
+            emitImmOp(code, inst, X86_ADD_IMM, inst.seImm);
+            break;
+        case OP_ANDI:
+            emitImmOp(code, inst, X86_AND_IMM, inst.imm);
+            break;
+        case OP_ORI:
+            emitImmOp(code, inst, X86_OR_IMM, inst.imm);
+            break;
+        case OP_SLTI:
+            emitImmOp(code, inst, X86_CMP_IMM, inst.seImm);
+            emitSet(code, X86_SETL);
+            break;
+        case OP_SLTIU:
+            emitImmOp(code, inst, X86_CMP_IMM, inst.seImm);
+            emitSet(code, X86_SETB);
+            break;
+        case OP_LUI:
+            code.push_back(0xb8);
+            emit32(code, static_cast<uint32_t>(inst.imm) << 16);
+            break;
+        default:
+            return false;
+    }
+
+    emitStoreReg(code, dest);
+    return true;
+}
+
+//Throws away all native code, so the buffer can be reused. Blocks have to get hot again.
+void flushNative()
+{
+    for(uint32_t i = 0 ; i < MEMORY_SIZE / WORD_SIZE ; i++)
+    {
+        if(blocks[i])
+        {
+            blocks[i]->runs = 0;
+            blocks[i]->native = nullptr;
+            blocks[i]->nativeInsts = 0;
+        }
+    }
+    jitUsed = 0;
+}
+
+void compileNative(TranslatedBlock & block)
+{
+    vector<uint8_t> code;
+    uint32_t count = 0;
+    while(count < block.insts.size() && compileNativeInst(block.insts[count], count, code))
+    {
+        count++;
+    }
+
+    if(count < JIT_MIN_INSTS)
+    {
+        return;
+    }
+    emitReturn(code, count);
+
+    if(!jitBuffer)
+    {
+        void *buffer = mmap(nullptr, JIT_BUFFER_SIZE, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(buffer == MAP_FAILED)
+        {
+            //Carry on interpreting.
+            jitEnabled = false;
+            return;
+        }
+        jitBuffer = static_cast<uint8_t *>(buffer);
+    }
+
+    if(jitUsed + code.size() > JIT_BUFFER_SIZE)
+    {
+        flushNative();
+    }
+
+    //The buffer is only ever writable or executable, never both.
+    if(mprotect(jitBuffer, JIT_BUFFER_SIZE, PROT_READ | PROT_WRITE))
+    {
+        jitEnabled = false;
+        return;
+    }
+    memcpy(jitBuffer + jitUsed, code.data(), code.size());
+    if(mprotect(jitBuffer, JIT_BUFFER_SIZE, PROT_READ | PROT_EXEC))
+    {
+        jitEnabled = false;
+        return;
+    }
+
+    block.native = reinterpret_cast<NativeBlock>(jitBuffer + jitUsed);
+    block.nativeInsts = count;
+    //Keep each block's code 16-byte aligned.
+    jitUsed += (code.size() + 15) & ~15u;
+}
+
+void freeNative()
+{
+    if(jitBuffer)
+    {
+        munmap(jitBuffer, JIT_BUFFER_SIZE);
+        jitBuffer = nullptr;
+    }
+}
+
+#else
+
+//No JIT for this host: --jit runs the block engine alone.
+void compileNative(TranslatedBlock & block)
+{
+    jitEnabled = false;
+}
+
+void freeNative()
+{
+}
+
+#endif
+
+bool endsBlock(const TranslatedInst & inst)
+{
+    return inst.handler == execBeq || inst.handler == execBne || inst.handler == execBlez ||
+           inst.handler == execBgtz || inst.handler == execJ || inst.handler == execJal ||
+           inst.handler == execJr;
+}
+
+//Finds the valid block starting at pc, building it if need be. block is left null if pc holds
+//the end of the program.
+int getBlock(uint32_t pc, TranslatedBlock *& block)
+{
+    TranslatedBlock *& entry = blocks[pc / WORD_SIZE];
+    if(entry && entry->valid)
+    {
+        block = entry;
+        return 0;
+    }
+
+    if(!entry)
+    {
+        entry = new TranslatedBlock();
+        entry->startPC = pc;
+    }
+    entry->insts.clear();
+    entry->taken = nullptr;
+    entry->fallThrough = nullptr;
+    entry->runs = 0;
+    entry->native = nullptr;
+    entry->nativeInsts = 0;
+
+    uint32_t addr = pc;
+    bool inDelaySlot = false;
+    while(entry->insts.size() < BLOCK_MAX_INSTS)
+    {
+        //Past the first word, stop short of any fetch the memory would refuse (and complain
+        //about), so it only happens if the program really gets there.
+        if(!entry->insts.empty() && addr + WORD_SIZE >= MEMORY_SIZE)
+        {
+            break;
+        }
+
+        const TranslatedInst *inst;
+        int ret = getTranslation(addr, inst);
+        if(ret)
+        {
+            return ret;
+        }
+        if(inst->instr == MAGIC_DEMARC)
+        {
+            break;
+        }
+
+        entry->insts.push_back(*inst);
+        blockCode[addr / WORD_SIZE] = true;
+        addr += 4;
+
+        //The delay slot runs as part of the block when the branch is not taken.
+        if(inDelaySlot)
+        {
+            break;
+        }
+        inDelaySlot = endsBlock(*inst);
+    }
+
+    if(entry->insts.empty())
+    {
+        block = nullptr;
+        return 0;
+    }
+
+    entry->fallThroughPC = addr;
+    entry->valid = true;
+    block = entry;
+    return 0;
+}
+
+//Runs a block from its first instruction, leaving as soon as the PC goes anywhere but the next
+//instruction in it or a store invalidates a block.
+int runBlock(TranslatedBlock & block)
+{
+    blockInvalidated = false;
+    uint32_t first = 0;
+
+    if(jitEnabled && !block.native && ++block.runs == JIT_HOT_RUNS)
+    {
+        compileNative(block);
+    }
+
+    if(block.native)
+    {
+        first = block.native(regs);
+        progCounter += first * 4;
+        if(first < block.nativeInsts)
+        {
+            //The native code stopped at an add or sub that overflowed.
+            finishInstruction(OVERFLOW, false);
+            return 0;
+        }
+    }
+
+    for(uint32_t i = first ; i < block.insts.size() ; i++)
+    {
+        const TranslatedInst & inst = block.insts[i];
+        uint32_t curPC = progCounter;
+        int ret = finishInstruction(inst.handler(inst), false);
+
+        if(ret)
+        {
+            cerr << "Error executing instruction " << "0x" << hex << setfill('0')
+                 << setw(8) << inst.instr << " at address " << "0x" << curPC << endl;
+            return -EINVAL;
+        }
+
+        if(blockInvalidated || progCounter != curPC + 4)
+        {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+//As runTranslatedProgram, a block at a time.
+int runBlockProgram()
+{
+    TranslatedBlock *lastBlock = nullptr;
+
+    while(true)
+    {
+        if(progCounter % WORD_SIZE != 0 || progCounter >= MEMORY_SIZE)
+        {
+            uint32_t curInst = 0;
+            uint32_t curPC = progCounter;
+            if(mem->getMemValue(progCounter, curInst, WORD_SIZE))
+            {
+                return -EBADF;
+            }
+            if(curInst == MAGIC_DEMARC)
+            {
+                break;
+            }
+            if(runInstruction(curInst))
+            {
+                cerr << "Error executing instruction " << "0x" << hex << setfill('0')
+                     << setw(8) << curInst << " at address " << "0x" << curPC << endl;
+                return -EINVAL;
+            }
+            lastBlock = nullptr;
+            continue;
+        }
+
+        //Follow the link out of the last block if it still leads here.
+        TranslatedBlock *block = nullptr;
+        TranslatedBlock **link = nullptr;
+        if(lastBlock && lastBlock->valid)
+        {
+            link = (progCounter == lastBlock->fallThroughPC) ? &lastBlock->fallThrough : &lastBlock->taken;
+            if(*link && (*link)->valid && (*link)->startPC == progCounter)
+            {
+                block = *link;
+            }
+        }
+
+        if(!block)
+        {
+            if(getBlock(progCounter, block))
+            {
+                return -EBADF;
+            }
+            if(!block)
+            {
+                break;
+            }
+            if(link)
+            {
+                *link = block;
+            }
+        }
+
+        if(runBlock(*block))
+        {
+            return -EINVAL;
+        }
+        lastBlock = block;
+    }
+
+    return 0;
+}
+
+void freeBlocks()
+{
+    for(uint32_t i = 0 ; i < MEMORY_SIZE / WORD_SIZE ; i++)
+    {
+        delete blocks[i];
+        blocks[i] = nullptr;
+    }
+}
+
+//Writes where the program has got to, its registers and all of memory as a checkpoint the
+//cycle-accurate simulator can carry on from (see SnapshotFile.h). Returns 0, or a negative
+//error after saying why.
+int saveArchState(const char *fileName)
+{
+    SnapshotHeader header;
+    std::vector<SnapshotRun> runs{SnapshotRun{0, MEMORY_SIZE - 1, 0}};
+    uint64_t size = layoutSnapshot(header, 0, 0, 0, sizeof(ArchSnapshot), runs);
+    uint8_t *image = createSnapshotFile(fileName, size);
+    if(!image)
+    {
+        return -EBADF;
+    }
+
+    ArchSnapshot arch;
+    arch.pc = progCounter;
+    memcpy(arch.regs, regs, sizeof(arch.regs));
+
+    memcpy(image, &header, sizeof(header));
+    memcpy(image + header.arch.offset, &arch, sizeof(arch));
+    memcpy(image + header.runs.offset, runs.data(), header.runs.size);
+    int ret = mem->getMemBlock(0, image + runs[0].offset, runs[0].size);
+
+    if(munmap(image, size) != 0)
+    {
+        ret = -EBADF;
+    }
+    return ret;
+}
+
+//Starts the program in fileName from the beginning: fresh memory, every register zero and the
+//PC at 0.
+int startProgram(const char *fileName)
+{
+    delete mem;
+    mem = new FlatMemoryStore();
+
+    if(loadProgram(fileName, mem))
+    {
+        return -EBADF;
+    }
+
+    for(int i = 0 ; i < NUM_REGS ; i++)
+    {
+        //This'll initialise the zero register appropriately too...
+        regs[i] = 0;
+    }
+
+    progCounter = 0;
+    ll_sc_flag = false;
+    instructionsRun = 0;
+    return 0;
+}
+
+//Profiles the program an interval at a time and clusters the intervals (see SimPoint.h), then
+//runs it again from the start to save a checkpoint where each sampled interval begins, with a
+//trace of the interval before it. The plan goes to planName; the checkpoints and traces are
+//named after it and the interval, as <plan>.<interval>.snp and .trc.
+int runSimPoints(const char *fileName, uint64_t interval, uint32_t clusterCount, uint32_t samplesPerCluster,
+                 const char *planName)
+{
+    BasicBlockProfile profile(interval);
+    blockProfile = &profile;
+    int ret = runProgram();
+    blockProfile = nullptr;
+    if(ret)
+    {
+        return ret;
+    }
+    profile.finish(instructionsRun);
+    uint64_t total = instructionsRun;
+
+    const std::vector<uint64_t> & starts = profile.getStarts();
+    std::vector<SimPointCluster> clusters = chooseSimPoints(profile.getPoints(), clusterCount, samplesPerCluster);
+    auto length = [&](uint32_t i)
+    {
+        return (i + 1 < starts.size() ? starts[i + 1] : total) - starts[i];
+    };
+
+    ofstream plan(planName);
+    if(!plan)
+    {
+        cout << "Could not write " << planName << endl;
+        return -EBADF;
+    }
+    plan << "interval " << interval << endl << "instructions " << total << endl;
+
+    //Each sampled interval with its cluster, in the order the second run comes to them.
+    std::vector<std::pair<uint32_t, uint32_t>> samples;
+    for(uint32_t c = 0 ; c < clusters.size() ; c++)
+    {
+        uint64_t instructions = 0;
+        for(uint32_t i : clusters[c].intervals)
+        {
+            instructions += length(i);
+        }
+        plan << "cluster " << c << " " << clusters[c].intervals.size() << " " << instructions << endl;
+        for(uint32_t i : clusters[c].samples)
+        {
+            samples.push_back({i, c});
+        }
+    }
+    std::sort(samples.begin(), samples.end());
+
+    if(startProgram(fileName))
+    {
+        return -EBADF;
+    }
+    for(auto & sample : samples)
+    {
+        uint32_t i = sample.first;
+        std::string name = std::string(planName) + "." + std::to_string(i);
+        stopAfter = i ? starts[i - 1] : 0;
+        ret = runProgram();
+
+        trace = new TraceWriter;
+        ret |= trace->open((name + ".trc").c_str(), TRACE_INSTRUCTIONS);
+        stopAfter = starts[i];
+        ret |= runProgram();
+        ret |= trace->close();
+        delete trace;
+        trace = nullptr;
+
+        if(ret || saveArchState((name + ".snp").c_str()))
+        {
+            return -EINVAL;
+        }
+        plan << "sample " << sample.second << " " << i << " " << length(i) << " " << name << ".snp "
+             << name << ".trc" << endl;
+    }
+    stopAfter = UINT64_MAX;
+
+    cout << "Profiled " << dec << starts.size() << " intervals of " << interval << " instructions into "
+         << clusters.size() << " clusters, with " << samples.size() << " to simulate" << endl;
+    return plan ? 0 : -EBADF;
+}
+
+int main(int argc, char *argv[])
+{
+    //Programs run a translated block at a time unless asked for --decoded, one translated
+    //instruction at a time, or --reference, the original interpreter. --jit also compiles the
+    //hot blocks to native code. --trace runs the original interpreter, recording every access
+    //it makes to a trace file.
+    //--fast-forward and --until-pc run the original interpreter only as far as the given number
+    //of instructions or PC, then save a checkpoint for the cycle-accurate simulator to carry on
+    //from, along with a trace of the accesses so far to warm its caches with if one is named.
+    //--simpoints plans a sampled simulation, see runSimPoints; each cluster gets two samples
+    //unless told otherwise.
+    bool simPoints = (argc == 6 || argc == 7) && strcmp(argv[2], "--simpoints") == 0;
+    bool fastForward = (argc == 5 || argc == 6) &&
+                       (strcmp(argv[2], "--fast-forward") == 0 || strcmp(argv[2], "--until-pc") == 0);
+    bool tracing = (argc == 4 && strcmp(argv[2], "--trace") == 0) || (fastForward && argc == 6);
+    bool reference = (argc == 3 && strcmp(argv[2], "--reference") == 0) || tracing || fastForward;
+    bool decoded = argc == 3 && strcmp(argv[2], "--decoded") == 0;
+    jitEnabled = argc == 3 && strcmp(argv[2], "--jit") == 0;
+    if(argc != 2 && !reference && !decoded && !jitEnabled && !simPoints)
+    {
+        cout << "Usage: ./sim <file name> [--reference | --decoded | --jit | --trace <trace file>]" << endl
+             << "       ./sim <file name> --fast-forward <instructions> <checkpoint file> [<trace file>]" << endl
+             << "       ./sim <file name> --until-pc <pc> <checkpoint file> [<trace file>]" << endl
+             << "       ./sim <file name> --simpoints <interval> <clusters> <plan file> [<samples per cluster>]" << endl;
+        return -EINVAL;
+    }
+    if(fastForward && strcmp(argv[2], "--fast-forward") == 0)
+    {
+        stopAfter = strtoull(argv[3], nullptr, 0);
+    }
+    else if(fastForward)
+    {
+        stopPC = strtoul(argv[3], nullptr, 0);
+    }
+    const char *traceName = fastForward ? argv[5] : argv[3];
+
+    if(startProgram(argv[1]))
+    {
+        return -EBADF;
+    }
+
+    if(simPoints)
+    {
+        uint64_t interval = strtoull(argv[3], nullptr, 0);
+        uint32_t clusters = strtoul(argv[4], nullptr, 0);
+        uint32_t samples = argc == 7 ? strtoul(argv[6], nullptr, 0) : 2;
+        int ret = -EINVAL;
+        if(interval && clusters && samples)
+        {
+            ret = runSimPoints(argv[1], interval, clusters, samples, argv[5]);
+        }
+        else
+        {
+            cout << "The interval, clusters and samples per cluster must all be above 0" << endl;
+        }
+        delete mem;
+        return ret;
+    }
+
+    //Run the program...
+
+    if(tracing)
+    {
+        trace = new TraceWriter;
+        if(trace->open(traceName, TRACE_INSTRUCTIONS))
+        {
+            return -EBADF;
+        }
+    }
+
+    if(fastForward)
+    {
+        int ret = runProgram();
+        delete trace;
+        if(ret || saveArchState(argv[4]))
+        {
+            return -EINVAL;
+        }
+        cout << "Fast-forwarded " << dec << instructionsRun << " instructions to PC 0x" << hex
+             << setfill('0') << setw(8) << progCounter << endl;
+        delete mem;
+        return 0;
+    }
+    else if(reference)
+    {
+        runProgram();
+    }
+    else if(decoded)
+    {
+        runTranslatedProgram();
+    }
+    else
+    {
+        runBlockProgram();
+    }
 
     //Set the register values in the struct for printing...
     RegisterInfo reg;
@@ -727,6 +2025,10 @@ int main(int argc, char *argv[])
     dumpRegisterState(reg);
     dumpMemoryState(mem);
 
+    freeBlocks();
+    freeNative();
+    //Closing the trace writes out the rest of it.
+    delete trace;
     delete mem;
     return 0;
 }
\ No newline at end of file
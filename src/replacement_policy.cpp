@@ -0,0 +1,204 @@
+#include <string.h>
+#include "CacheConfig.h"
+#include "replacement_policy.h"
+
+// checkpoint helpers: copy an array, then a counter, and step past them
+template <typename T>
+static uint8_t *saveBytes(uint8_t *state, const T *values, size_t count) {
+    memcpy(state, values, count * sizeof(T));
+    return state + count * sizeof(T);
+}
+
+template <typename T>
+static const uint8_t *loadBytes(const uint8_t *state, T *values, size_t count) {
+    memcpy(values, state, count * sizeof(T));
+    return state + count * sizeof(T);
+}
+
+LRUPolicy::LRUPolicy(uint32_t numSets, uint32_t assoc) : lastUse(numSets * assoc, 0), clock(0), assoc(assoc) {}
+
+void LRUPolicy::touch(uint32_t set, uint32_t way) {
+    lastUse[set * assoc + way] = ++clock;
+}
+
+void LRUPolicy::fill(uint32_t set, uint32_t way) {
+    touch(set, way);
+}
+
+uint32_t LRUPolicy::victim(uint32_t set) {
+    const uint64_t *stamps = &lastUse[set * assoc];
+    uint32_t oldest = 0;
+    for (uint32_t i = 1; i < assoc; i++) {
+        if (stamps[i] < stamps[oldest]) oldest = i;
+    }
+    return oldest;
+}
+
+uint32_t LRUPolicy::stateSize() {
+    return lastUse.size() * sizeof(uint64_t) + sizeof(clock);
+}
+
+void LRUPolicy::saveState(uint8_t *state) {
+    saveBytes(saveBytes(state, lastUse.data(), lastUse.size()), &clock, 1);
+}
+
+void LRUPolicy::loadState(const uint8_t *state) {
+    loadBytes(loadBytes(state, lastUse.data(), lastUse.size()), &clock, 1);
+}
+
+TreePLRUPolicy::TreePLRUPolicy(uint32_t numSets, uint32_t assoc) : assoc(assoc) {
+    levels = 0;
+    while ((1u << levels) < assoc) levels++;
+    nodesPerSet = (1u << levels) - 1;
+    treeBits.assign(numSets * nodesPerSet, 0);
+}
+
+// node n has children 2n+1 (lower half) and 2n+2 (upper half); a bit of 1 means the upper half is colder
+void TreePLRUPolicy::touch(uint32_t set, uint32_t way) {
+    uint8_t *tree = &treeBits[set * nodesPerSet];
+    uint32_t node = 0;
+    for (uint32_t level = levels; level > 0; level--) {
+        uint32_t upper = (way >> (level - 1)) & 1;
+        tree[node] = !upper;
+        node = 2 * node + 1 + upper;
+    }
+}
+
+void TreePLRUPolicy::fill(uint32_t set, uint32_t way) {
+    touch(set, way);
+}
+
+uint32_t TreePLRUPolicy::victim(uint32_t set) {
+    const uint8_t *tree = &treeBits[set * nodesPerSet];
+    uint32_t node = 0, way = 0;
+    for (uint32_t level = levels; level > 0; level--) {
+        uint32_t upper = tree[node];
+        // the upper half may not exist when assoc is not a power of two
+        if (upper && (((way << 1) | 1) << (level - 1)) >= assoc) upper = 0;
+        way = (way << 1) | upper;
+        node = 2 * node + 1 + upper;
+    }
+    return way;
+}
+
+uint32_t TreePLRUPolicy::stateSize() {
+    return treeBits.size();
+}
+
+void TreePLRUPolicy::saveState(uint8_t *state) {
+    saveBytes(state, treeBits.data(), treeBits.size());
+}
+
+void TreePLRUPolicy::loadState(const uint8_t *state) {
+    loadBytes(state, treeBits.data(), treeBits.size());
+}
+
+FIFOPolicy::FIFOPolicy(uint32_t numSets, uint32_t assoc) : filledAt(numSets * assoc, 0), clock(0), assoc(assoc) {}
+
+void FIFOPolicy::touch(uint32_t /* set */, uint32_t /* way */) {}
+
+void FIFOPolicy::fill(uint32_t set, uint32_t way) {
+    filledAt[set * assoc + way] = ++clock;
+}
+
+uint32_t FIFOPolicy::victim(uint32_t set) {
+    const uint64_t *stamps = &filledAt[set * assoc];
+    uint32_t oldest = 0;
+    for (uint32_t i = 1; i < assoc; i++) {
+        if (stamps[i] < stamps[oldest]) oldest = i;
+    }
+    return oldest;
+}
+
+uint32_t FIFOPolicy::stateSize() {
+    return filledAt.size() * sizeof(uint64_t) + sizeof(clock);
+}
+
+void FIFOPolicy::saveState(uint8_t *state) {
+    saveBytes(saveBytes(state, filledAt.data(), filledAt.size()), &clock, 1);
+}
+
+void FIFOPolicy::loadState(const uint8_t *state) {
+    loadBytes(loadBytes(state, filledAt.data(), filledAt.size()), &clock, 1);
+}
+
+RandomPolicy::RandomPolicy(uint32_t assoc) : state(0x2545f491), assoc(assoc) {}
+
+void RandomPolicy::touch(uint32_t /* set */, uint32_t /* way */) {}
+
+void RandomPolicy::fill(uint32_t /* set */, uint32_t /* way */) {}
+
+uint32_t RandomPolicy::victim(uint32_t /* set */) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state % assoc;
+}
+
+uint32_t RandomPolicy::stateSize() {
+    return sizeof(this->state);
+}
+
+void RandomPolicy::saveState(uint8_t *state) {
+    saveBytes(state, &this->state, 1);
+}
+
+void RandomPolicy::loadState(const uint8_t *state) {
+    loadBytes(state, &this->state, 1);
+}
+
+#define RRPV_MAX 3
+
+SRRIPPolicy::SRRIPPolicy(uint32_t numSets, uint32_t assoc) : rrpv(numSets * assoc, RRPV_MAX), assoc(assoc) {}
+
+void SRRIPPolicy::touch(uint32_t set, uint32_t way) {
+    rrpv[set * assoc + way] = 0;
+}
+
+void SRRIPPolicy::fill(uint32_t set, uint32_t way) {
+    rrpv[set * assoc + way] = RRPV_MAX - 1;
+}
+
+uint32_t SRRIPPolicy::victim(uint32_t set) {
+    uint8_t *values = &rrpv[set * assoc];
+    // age the whole set by the distance of its most distant block, then take the first such block
+    uint8_t oldest = 0;
+    for (uint32_t i = 0; i < assoc; i++) {
+        if (values[i] > oldest) oldest = values[i];
+    }
+    uint8_t age = RRPV_MAX - oldest;
+    uint32_t chosen = assoc;
+    for (uint32_t i = 0; i < assoc; i++) {
+        values[i] += age;
+        if (chosen == assoc && values[i] == RRPV_MAX) chosen = i;
+    }
+    return chosen;
+}
+
+uint32_t SRRIPPolicy::stateSize() {
+    return rrpv.size();
+}
+
+void SRRIPPolicy::saveState(uint8_t *state) {
+    saveBytes(state, rrpv.data(), rrpv.size());
+}
+
+void SRRIPPolicy::loadState(const uint8_t *state) {
+    loadBytes(state, rrpv.data(), rrpv.size());
+}
+
+ReplacementPolicy *createReplacementPolicy(ReplacementType type, uint32_t numSets, uint32_t assoc) {
+    switch (type) {
+        case TREE_PLRU:
+            return new TreePLRUPolicy(numSets, assoc);
+        case FIFO:
+            return new FIFOPolicy(numSets, assoc);
+        case RANDOM:
+            return new RandomPolicy(assoc);
+        case SRRIP:
+            return new SRRIPPolicy(numSets, assoc);
+        case LRU:
+        default:
+            return new LRUPolicy(numSets, assoc);
+    }
+}
@@ -0,0 +1,103 @@
+#include <inttypes.h>
+#include <vector>
+
+using std::vector;
+
+// Decides which block of a full set a cache evicts. The cache fills empty
+// blocks itself and only asks for a victim once every way of the set is valid.
+// Per-block state is indexed set-major, set * assoc + way, like the cache's own arrays.
+class ReplacementPolicy {
+    public:
+        virtual ~ReplacementPolicy() {}
+        // a valid block was hit
+        virtual void touch(uint32_t set, uint32_t way) = 0;
+        // a block was just filled from memory
+        virtual void fill(uint32_t set, uint32_t way) = 0;
+        // the block to evict from a set whose ways are all valid
+        virtual uint32_t victim(uint32_t set) = 0;
+        // for checkpoints: the whole state, as stateSize() bytes copied out and back in as they are
+        virtual uint32_t stateSize() = 0;
+        virtual void saveState(uint8_t *state) = 0;
+        virtual void loadState(const uint8_t *state) = 0;
+};
+
+// true LRU: every touch stamps the block, the oldest stamp is evicted
+class LRUPolicy : public ReplacementPolicy {
+    private:
+        vector<uint64_t> lastUse;
+        uint64_t clock;
+        uint32_t assoc;
+    public:
+        LRUPolicy(uint32_t numSets, uint32_t assoc);
+        void touch(uint32_t set, uint32_t way);
+        void fill(uint32_t set, uint32_t way);
+        uint32_t victim(uint32_t set);
+        uint32_t stateSize();
+        void saveState(uint8_t *state);
+        void loadState(const uint8_t *state);
+};
+
+// binary-tree pseudo-LRU: assoc - 1 bits per set, each pointing at the colder half
+// below it. non power-of-two ways are handled by never descending into missing ways
+class TreePLRUPolicy : public ReplacementPolicy {
+    private:
+        vector<uint8_t> treeBits;
+        uint32_t assoc, levels, nodesPerSet;
+    public:
+        TreePLRUPolicy(uint32_t numSets, uint32_t assoc);
+        void touch(uint32_t set, uint32_t way);
+        void fill(uint32_t set, uint32_t way);
+        uint32_t victim(uint32_t set);
+        uint32_t stateSize();
+        void saveState(uint8_t *state);
+        void loadState(const uint8_t *state);
+};
+
+// first in, first out: only fills are stamped, hits do not change the order
+class FIFOPolicy : public ReplacementPolicy {
+    private:
+        vector<uint64_t> filledAt;
+        uint64_t clock;
+        uint32_t assoc;
+    public:
+        FIFOPolicy(uint32_t numSets, uint32_t assoc);
+        void touch(uint32_t set, uint32_t way);
+        void fill(uint32_t set, uint32_t way);
+        uint32_t victim(uint32_t set);
+        uint32_t stateSize();
+        void saveState(uint8_t *state);
+        void loadState(const uint8_t *state);
+};
+
+// uniformly random victim from a fixed-seed xorshift generator, so runs are repeatable
+class RandomPolicy : public ReplacementPolicy {
+    private:
+        uint32_t state;
+        uint32_t assoc;
+    public:
+        RandomPolicy(uint32_t assoc);
+        void touch(uint32_t set, uint32_t way);
+        void fill(uint32_t set, uint32_t way);
+        uint32_t victim(uint32_t set);
+        uint32_t stateSize();
+        void saveState(uint8_t *state);
+        void loadState(const uint8_t *state);
+};
+
+// static re-reference interval prediction with 2-bit counters: fills are predicted
+// long, hits near, and the first block predicted distant is evicted
+class SRRIPPolicy : public ReplacementPolicy {
+    private:
+        vector<uint8_t> rrpv;
+        uint32_t assoc;
+    public:
+        SRRIPPolicy(uint32_t numSets, uint32_t assoc);
+        void touch(uint32_t set, uint32_t way);
+        void fill(uint32_t set, uint32_t way);
+        uint32_t victim(uint32_t set);
+        uint32_t stateSize();
+        void saveState(uint8_t *state);
+        void loadState(const uint8_t *state);
+};
+
+ReplacementPolicy *createReplacementPolicy(ReplacementType type, uint32_t numSets, uint32_t assoc);
@@ -0,0 +1,80 @@
+#include <string.h>
+#include <algorithm>
+#include "CacheConfig.h"
+#include "stack_distance.h"
+
+static uint32_t log2Of(uint32_t value) {
+    uint32_t bits = 0;
+    while ((1u << bits) < value) bits++;
+    return bits;
+}
+
+// a set never needs more ways than the widest cache profiled with that many sets. with one set,
+// that is the fully associative cache of maxCacheSize
+StackDistanceProfiler::StackDistanceProfiler(CacheAnalysisConfig &config) : accesses(0) {
+    for (uint32_t blockSize = config.minBlockSize; blockSize <= config.maxBlockSize; blockSize *= 2) {
+        uint32_t maxBlocks = std::max(config.maxCacheSize / blockSize, 1u);
+        for (uint32_t numSets = 1; numSets <= maxBlocks; numSets *= 2) {
+            SetStacks stack;
+            stack.blockSize = blockSize;
+            stack.blockBits = log2Of(blockSize);
+            stack.numSets = numSets;
+            stack.depth = numSets == 1 ? maxBlocks : std::min(config.maxAssociativity, maxBlocks / numSets);
+            stack.blocks.assign(numSets * stack.depth, 0);
+            stack.filled.assign(numSets, 0);
+            stack.found.assign(stack.depth, 0);
+            stacks.push_back(stack);
+        }
+    }
+}
+
+// moves block to the top of its set's stack, dropping the bottom entry when it is new and the
+// stack is full
+void StackDistanceProfiler::touch(SetStacks &stack, uint32_t block, bool count) {
+    uint32_t set = block & (stack.numSets - 1);
+    uint32_t *entries = &stack.blocks[set * stack.depth];
+    uint32_t &filled = stack.filled[set];
+
+    uint32_t distance = 0;
+    while (distance < filled && entries[distance] != block) distance++;
+    if (distance < filled) {
+        if (count) stack.found[distance]++;
+    } else if (filled < stack.depth) {
+        filled++;
+    } else {
+        distance = stack.depth - 1;
+    }
+    memmove(entries + 1, entries, distance * sizeof(uint32_t));
+    entries[0] = block;
+}
+
+void StackDistanceProfiler::access(uint32_t address, uint32_t size) {
+    accesses++;
+    for (SetStacks &stack : stacks) {
+        uint32_t first = address >> stack.blockBits;
+        uint32_t last = (address + size - 1) >> stack.blockBits;
+        for (uint32_t block = first; block <= last; block++) {
+            touch(stack, block, block == first);
+        }
+    }
+}
+
+const StackDistanceProfiler::SetStacks *StackDistanceProfiler::findStacks(uint32_t blockSize, uint32_t numSets) {
+    for (const SetStacks &stack : stacks) {
+        if (stack.blockSize == blockSize && stack.numSets == numSets) return &stack;
+    }
+    return nullptr;
+}
+
+uint64_t StackDistanceProfiler::getHits(uint32_t cacheSize, uint32_t blockSize, uint32_t assoc) {
+    uint32_t numBlocks = blockSize ? cacheSize / blockSize : 0;
+    if (assoc == 0) assoc = numBlocks;
+    const SetStacks *stack = assoc ? findStacks(blockSize, numBlocks / assoc) : nullptr;
+    if (!stack || assoc > stack->depth) return 0;
+
+    uint64_t hits = 0;
+    for (uint32_t distance = 0; distance < assoc; distance++) {
+        hits += stack->found[distance];
+    }
+    return hits;
+}
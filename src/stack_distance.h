@@ -0,0 +1,34 @@
+#include <inttypes.h>
+#include <vector>
+
+using std::vector;
+
+// Mattson's LRU stack algorithm: an access that finds its block d places down the LRU stack of
+// its set hits in every LRU cache with more than d ways and misses in the rest, so one pass
+// over an access stream gives the hits of every associativity at once. A stack is kept for each
+// block size and power-of-two set count in a CacheAnalysisConfig, which covers every cache size
+// too. Only plain LRU caches are modelled: no prefetcher, victim cache or lower levels.
+class StackDistanceProfiler {
+    private:
+        // the LRU stacks of every set for one block size and set count. set s holds up to depth
+        // block numbers, most recent first, starting at blocks[s * depth]. found[d] counts the
+        // accesses met d places down
+        struct SetStacks {
+            uint32_t blockSize, blockBits, numSets, depth;
+            vector<uint32_t> blocks;
+            vector<uint32_t> filled;
+            vector<uint64_t> found;
+        };
+        vector<SetStacks> stacks;
+        uint64_t accesses;
+        void touch(SetStacks &stack, uint32_t block, bool count);
+        const SetStacks *findStacks(uint32_t blockSize, uint32_t numSets);
+    public:
+        StackDistanceProfiler(CacheAnalysisConfig &config);
+        // a demand access of size bytes. like the cache, it is counted by the first block it
+        // touches, but every block it touches becomes the most recent of its set
+        void access(uint32_t address, uint32_t size);
+        uint64_t getAccesses() { return accesses; }
+        // the hits an LRU cache of this geometry would have had. assoc 0 means fully associative
+        uint64_t getHits(uint32_t cacheSize, uint32_t blockSize, uint32_t assoc);
+};
@@ -2,8 +2,7 @@ for value in feed_end add_immediate and_immediate r load store branch j midterm
 do
     echo $value
     bin/mips-linux-gnu-as test/$value.asm -o $value.elf
-    bin/mips-linux-gnu-objcopy $value.elf -j .text -O binary $value.bin
-    ./sim $value.bin 
+    ./sim $value.elf
     sleep 0.25s
     diff -y reg_state.out test/${value}_reg_state.out
     mv mem_state.out ${value}_mem_state.out 
@@ -12,3 +11,126 @@ done
 
 diff -y fib_mem_state.out test/fib_mem_state.out
 diff -y store_mem_state.out test/store_mem_state.out
+
+# the cycle-accurate simulator, built from test/example_driver.cpp as cycle_sim
+for value in delay_miss stack_wrap
+do
+    echo $value
+    bin/mips-linux-gnu-as test/$value.asm -o $value.elf
+    ./cycle_sim $value.elf
+    sleep 0.25s
+    diff -y reg_state.out test/${value}_reg_state.out
+    mv mem_state.out ${value}_mem_state.out
+    mv reg_state.out ${value}_reg_state.out
+done
+
+# a 3-way D-cache, whose 5 sets are not a power of two, built from test/3way_driver.cpp as
+# cycle_sim_3way
+for value in store j midterm fib
+do
+    echo $value 3-way
+    bin/mips-linux-gnu-as test/$value.asm -o $value.elf
+    ./cycle_sim_3way $value.elf
+    sleep 0.25s
+    diff -y reg_state.out test/${value}_reg_state.out
+    mv mem_state.out ${value}_3way_mem_state.out
+    mv reg_state.out ${value}_3way_reg_state.out
+done
+
+diff -y fib_3way_mem_state.out test/fib_mem_state.out
+diff -y store_3way_mem_state.out test/store_mem_state.out
+
+# memory far above the low 64 KB, on the sparse store, built from test/sparse_driver.cpp as
+# cycle_sim_sparse
+for value in sparse
+do
+    echo $value
+    bin/mips-linux-gnu-as test/$value.asm -o $value.elf
+    ./cycle_sim_sparse $value.elf
+    sleep 0.25s
+    diff -y reg_state.out test/${value}_reg_state.out
+    mv mem_state.out ${value}_mem_state.out
+    mv reg_state.out ${value}_reg_state.out
+done
+
+# a trace of the caches, written by test/trace_driver.cpp (built as cycle_sim_trace) or by
+# ./sim --trace, and replayed by test/replay_driver.cpp (built as replay), counts as the
+# simulator did
+for value in fib store
+do
+    echo $value replay
+    bin/mips-linux-gnu-as test/$value.asm -o $value.elf
+    ./cycle_sim_trace $value.elf ${value}_cycles.trc
+    sleep 0.25s
+    grep "^[ID]-cache hits\|^[ID]-cache misses" sim_stats.out > ${value}_trace_stats.out
+    ./replay ${value}_cycles.trc | grep "cache" > ${value}_replay_stats.out
+    diff -y ${value}_trace_stats.out ${value}_replay_stats.out
+    ./sim $value.elf --trace ${value}_instructions.trc > /dev/null
+    ./replay ${value}_instructions.trc | grep "cache" > ${value}_replay_stats.out
+    diff -y ${value}_trace_stats.out ${value}_replay_stats.out
+    mv mem_state.out ${value}_mem_state.out
+    mv reg_state.out ${value}_reg_state.out
+done
+
+# the cache structures around the L1 caches, each built from test/<driver>_driver.cpp as
+# cycle_sim_<driver>, on blocks that conflict, with the statistics they add
+for driver in l2 nonblocking prefetch victim branch curve
+do
+    echo conflict $driver
+    bin/mips-linux-gnu-as test/conflict.asm -o conflict.elf
+    ./cycle_sim_$driver conflict.elf
+    sleep 0.25s
+    diff -y reg_state.out test/conflict_reg_state.out
+    diff -y sim_stats.out test/conflict_${driver}_sim_stats.out
+    mv sim_stats.out conflict_${driver}_sim_stats.out
+    mv mem_state.out conflict_${driver}_mem_state.out
+    mv reg_state.out conflict_${driver}_reg_state.out
+done
+# cycle_sim_curve also leaves the miss rate of every cache size it profiled
+diff -y cache_curve.out test/conflict_cache_curve.out
+mv cache_curve.out conflict_cache_curve.out
+
+# the design-space sweep, built from test/sweep_driver.cpp as sweep, over enough of the D-cache
+# for the conflicting arrays to fit, on more than one thread
+echo conflict sweep
+./sweep conflict.elf --dc-type direct,2way,full --dc-size 1024,4096 --dc-block 32,64 --threads 3 > conflict_sweep.csv
+diff -y conflict_sweep.csv test/conflict_sweep.csv
+
+# checkpoints, built from test/checkpoint_driver.cpp as cycle_sim_checkpoint: saved partway
+# through a run, then resumed to the same end as the run straight through
+echo conflict checkpoint
+./cycle_sim_checkpoint conflict.elf conflict.ckpt 500
+sleep 0.25s
+diff -y reg_state.out test/conflict_reg_state.out
+diff -y sim_stats.out test/conflict_sim_stats.out
+mv sim_stats.out conflict_checkpoint_sim_stats.out
+mv mem_state.out conflict_checkpoint_mem_state.out
+mv reg_state.out conflict_checkpoint_reg_state.out
+./cycle_sim_checkpoint --resume conflict.ckpt
+sleep 0.25s
+diff -y reg_state.out conflict_checkpoint_reg_state.out
+diff -y sim_stats.out conflict_checkpoint_sim_stats.out
+diff mem_state.out conflict_checkpoint_mem_state.out
+mv sim_stats.out conflict_resume_sim_stats.out
+mv mem_state.out conflict_resume_mem_state.out
+mv reg_state.out conflict_resume_reg_state.out
+
+# the pipeline carrying on from where ./sim --fast-forward stopped, built from
+# test/fastforward_driver.cpp as cycle_sim_fastforward, with its caches warmed by the trace
+echo conflict fastforward
+./sim conflict.elf --fast-forward 200 conflict.snp conflict.trc
+./cycle_sim_fastforward conflict.snp conflict.trc
+sleep 0.25s
+diff -y reg_state.out test/conflict_reg_state.out
+diff -y sim_stats.out test/conflict_fastforward_sim_stats.out
+mv sim_stats.out conflict_fastforward_sim_stats.out
+mv mem_state.out conflict_fastforward_mem_state.out
+mv reg_state.out conflict_fastforward_reg_state.out
+
+# sampled simulation: a plan profiled by ./sim --simpoints, and the whole run's statistics
+# estimated from it, built from test/sampled_driver.cpp as sampled
+echo conflict sampled
+./sim conflict.elf --simpoints 100 3 conflict.plan
+diff -y conflict.plan test/conflict.plan
+./sampled conflict.plan > conflict_sampled.out
+diff -y conflict_sampled.out test/conflict_sampled.out
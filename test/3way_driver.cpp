@@ -0,0 +1,52 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <errno.h>
+#include "../src/MemoryStore.h"
+#include "../src/ProgramLoader.h"
+#include "../src/RegisterInfo.h"
+#include "../src/EndianHelpers.h"
+#include "../src/DriverFunctions.h"
+
+using namespace std;
+
+static MemoryStore *mem;
+
+int main(int argc, char **argv)
+{
+    if(argc != 2)
+    {
+        cout << "Usage: ./cycle_sim <file name>" << endl;
+        return -EINVAL;
+    }
+
+    mem = createMemoryStore();
+
+    if(loadProgram(argv[1], mem))
+    {
+        return -EBADF;
+    }
+
+    CacheConfig icConfig;
+    icConfig.cacheSize = 1024;
+    icConfig.blockSize = 64;
+    icConfig.type = TWO_WAY_SET_ASSOC;
+    icConfig.missLatency = 5;
+    //A 3-way D-cache of 256 bytes in 16-byte blocks has 5 sets, not a power of two.
+    CacheConfig dcConfig = icConfig;
+    dcConfig.cacheSize = 256;
+    dcConfig.blockSize = 16;
+    dcConfig.type = SET_ASSOC;
+    dcConfig.associativity = 3;
+
+    initSimulator(icConfig, dcConfig, mem);
+
+    runCycles(10);
+
+    runTillHalt();
+
+    finalizeSimulator();
+
+    delete mem;
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <errno.h>
+#include "../src/MemoryStore.h"
+#include "../src/RegisterInfo.h"
+#include "../src/EndianHelpers.h"
+#include "../src/DriverFunctions.h"
+#include "../src/cache_sim.h"
+
+using namespace std;
+
+// Cache lookup microbenchmark. Hammers getCacheValue/setCacheValue with a
+// pseudo-random word access stream and reports lookups per second for a spread
+// of cache geometries. Misses are replayed once the fill completes, the same
+// way the pipeline retries them.
+
+#define ACCESSES 4000000
+
+struct BenchConfig
+{
+    uint32_t cacheSize;
+    uint32_t blockSize;
+    CacheType type;
+    uint32_t associativity;
+    ReplacementType replacement;
+};
+
+static const BenchConfig configs[] = {
+    {1024, 16, DIRECT_MAPPED, 0, LRU},
+    {1024, 64, TWO_WAY_SET_ASSOC, 0, LRU},
+    {2048, 64, DIRECT_MAPPED, 0, LRU},
+    {8192, 32, TWO_WAY_SET_ASSOC, 0, LRU},
+    {16384, 64, TWO_WAY_SET_ASSOC, 0, LRU},
+    {8192, 32, SET_ASSOC, 8, TREE_PLRU},
+    {8192, 32, SET_ASSOC, 8, SRRIP},
+    {4096, 64, FULLY_ASSOC, 0, LRU},
+    {4096, 64, FULLY_ASSOC, 0, TREE_PLRU},
+    {4096, 64, FULLY_ASSOC, 0, FIFO},
+    {4096, 64, FULLY_ASSOC, 0, RANDOM},
+    {4096, 64, FULLY_ASSOC, 0, SRRIP},
+};
+
+static const char *typeNames[] = {"direct-mapped", "two-way", "set-assoc", "fully-assoc"};
+static const char *replacementNames[] = {"lru", "tree-plru", "fifo", "random", "srrip"};
+
+int main(int argc, char **argv)
+{
+    MemoryStore *mem = createMemoryStore();
+
+    for(const BenchConfig & bench : configs)
+    {
+        CacheConfig config;
+        config.cacheSize = bench.cacheSize;
+        config.blockSize = bench.blockSize;
+        config.type = bench.type;
+        config.missLatency = 4;
+        config.associativity = bench.associativity;
+        config.replacement = bench.replacement;
+
+        //A working set that fits measures the lookup itself, one twice the
+        //cache size measures the miss path as well.
+        for(uint32_t spanScale = 1; spanScale <= 4; spanScale *= 4)
+        {
+            Cache cache(config, mem);
+
+            //Keep the working set inside memory and word aligned.
+            uint32_t span = min<uint32_t>(spanScale * bench.cacheSize / 2, MEMORY_SIZE / 2);
+            uint32_t seed = 12345;
+            uint32_t cycle = 0;
+            uint32_t sum = 0;
+
+            auto start = chrono::steady_clock::now();
+            for(uint32_t i = 0; i < ACCESSES; i++)
+            {
+                seed = seed * 1103515245 + 12345;
+                uint32_t addr = (seed >> 8) % span & ~3u;
+                uint32_t value = 0;
+
+                cycle++;
+
+                if(i % 5 == 4)
+                {
+                    if(int delay = cache.setCacheValue(addr, i, WORD_SIZE, cycle))
+                    {
+                        cycle += delay;
+                        cache.setCacheValue(addr, i, WORD_SIZE, cycle);
+                    }
+                }
+                else
+                {
+                    if(int delay = cache.getCacheValue(addr, value, WORD_SIZE, cycle))
+                    {
+                        cycle += delay;
+                        cache.getCacheValue(addr, value, WORD_SIZE, cycle);
+                    }
+                    sum += value;
+                }
+            }
+            auto end = chrono::steady_clock::now();
+
+            double seconds = chrono::duration<double>(end - start).count();
+            cout << setw(6) << bench.cacheSize << "B "
+                 << setw(3) << bench.blockSize << "B blocks "
+                 << left << setw(14) << typeNames[bench.type]
+                 << setw(10) << (bench.type == DIRECT_MAPPED ? "" : replacementNames[bench.replacement]) << right
+                 << (spanScale == 1 ? "fits    " : "thrashes")
+                 << fixed << setprecision(2) << setw(8) << (ACCESSES / seconds) / 1e6 << " M lookups/s"
+                 << "  (hits " << cache.getHits() << ", misses " << cache.getMisses()
+                 << ", checksum 0x" << hex << sum << dec << ")" << endl;
+        }
+    }
+
+    delete mem;
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "../src/MemoryStore.h"
+#include "../src/ProgramLoader.h"
+#include "../src/RegisterInfo.h"
+#include "../src/EndianHelpers.h"
+#include "../src/DriverFunctions.h"
+
+using namespace std;
+
+static MemoryStore *mem;
+
+//Runs a program for the given number of cycles, saves a checkpoint and runs on to the end, or
+//carries on from a checkpoint to the end. Either way the final state and statistics are those
+//of a run straight through.
+int main(int argc, char **argv)
+{
+    bool resume = argc == 3 && strcmp(argv[1], "--resume") == 0;
+    if(argc != 4 && !resume)
+    {
+        cout << "Usage: ./cycle_sim <file name> <checkpoint file> <cycles>" << endl
+             << "       ./cycle_sim --resume <checkpoint file>" << endl;
+        return -EINVAL;
+    }
+
+    mem = createMemoryStore();
+
+    if(resume)
+    {
+        if(initSimulatorFromCheckpoint(argv[2], mem))
+        {
+            return -EBADF;
+        }
+    }
+    else
+    {
+        if(loadProgram(argv[1], mem))
+        {
+            return -EBADF;
+        }
+
+        CacheConfig icConfig;
+        icConfig.cacheSize = 1024;
+        icConfig.blockSize = 64;
+        icConfig.type = TWO_WAY_SET_ASSOC;
+        icConfig.missLatency = 5;
+        CacheConfig dcConfig = icConfig;
+
+        initSimulator(icConfig, dcConfig, mem);
+
+        if(runCycles(strtoul(argv[3], nullptr, 0)) == 0 && saveCheckpoint(argv[2]))
+        {
+            return -EBADF;
+        }
+    }
+
+    runTillHalt();
+
+    finalizeSimulator();
+
+    delete mem;
+    return 0;
+}
@@ -0,0 +1,30 @@
+# Three arrays 2 KB apart, walked a 64-byte block at a time, so that their blocks fight over the
+# same sets of a direct-mapped D-cache. Each pass loads from one, stores to the next and loads
+# from the third, then they rotate, so later passes read back what earlier ones stored after it
+# has been evicted: work for victim caches, write buffers, prefetchers, MSHRs and an L2.
+.set noreorder
+main:   addi    $t0, $zero, 0x1000      # the array loaded first
+        addi    $t1, $zero, 0x1800      # the array stored to
+        addi    $t2, $zero, 0x2000      # the array loaded second
+        addi    $s1, $zero, 3           # passes left
+pass:   add     $t5, $zero, $zero       # offset into the arrays
+        addi    $t6, $zero, 16          # blocks left in this pass
+walk:   add     $t7, $t0, $t5
+        lw      $t4, 0($t7)
+        add     $t7, $t1, $t5
+        add     $s0, $s0, $t4
+        add     $t8, $t6, $s1
+        sw      $t8, 0($t7)             # pass + blocks left, so every store is different
+        add     $t7, $t2, $t5
+        lw      $t4, 0($t7)
+        addi    $t6, $t6, -1
+        add     $s0, $s0, $t4
+        bne     $t6, $zero, walk
+        addi    $t5, $t5, 64            # delay slot: the next block
+        add     $t3, $t0, $zero         # rotate: stored to becomes loaded first
+        add     $t0, $t1, $zero
+        add     $t1, $t2, $zero
+        addi    $s1, $s1, -1
+        bne     $s1, $zero, pass
+        add     $t2, $t3, $zero         # delay slot
+        .word   0xfeedfeed
@@ -0,0 +1,24 @@
+# A jump at the end of an I-cache block, so that fetching its delay slot misses. The jump has to
+# wait in decode for that fetch, or its target is lost and the wrong path runs.
+.set noreorder
+main:   addi    $t0, $t0, 1
+        addi    $t0, $t0, 1
+        addi    $t0, $t0, 1
+        addi    $t0, $t0, 1
+        addi    $t0, $t0, 1
+        addi    $t0, $t0, 1
+        addi    $t0, $t0, 1
+        addi    $t0, $t0, 1
+        addi    $t0, $t0, 1
+        addi    $t0, $t0, 1
+        addi    $t0, $t0, 1
+        addi    $t0, $t0, 1
+        addi    $t0, $t0, 1
+        addi    $t0, $t0, 1
+        addi    $t0, $t0, 1
+        j       target      # pos 60, the last word of a 64-byte block
+        addi    $t1, $zero, 2     # pos 64, the delay slot
+        addi    $t2, $zero, 1     # skipped
+        .word   0xfeedfeed
+target: addi    $t3, $zero, 3
+        .word   0xfeedfeed
@@ -0,0 +1,51 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "../src/MemoryStore.h"
+#include "../src/RegisterInfo.h"
+#include "../src/EndianHelpers.h"
+#include "../src/DriverFunctions.h"
+
+using namespace std;
+
+static MemoryStore *mem;
+
+//Carries on in the pipeline from where ./sim --fast-forward or --until-pc stopped, with the
+//caches of the 2-way driver, warmed with the trace it wrote if one is given. The statistics
+//count from the handoff on; the final state is that of a run straight through.
+int main(int argc, char **argv)
+{
+    if(argc != 2 && argc != 3)
+    {
+        cout << "Usage: ./cycle_sim <checkpoint file> [<trace file>]" << endl;
+        return -EINVAL;
+    }
+
+    mem = createMemoryStore();
+
+    CacheConfig icConfig;
+    icConfig.cacheSize = 1024;
+    icConfig.blockSize = 64;
+    icConfig.type = TWO_WAY_SET_ASSOC;
+    icConfig.missLatency = 5;
+    CacheConfig dcConfig = icConfig;
+
+    if(initSimulatorFromCheckpoint(argv[1], icConfig, dcConfig, mem))
+    {
+        return -EBADF;
+    }
+    if(argc == 3 && warmCaches(argv[2]))
+    {
+        return -EBADF;
+    }
+
+    runTillHalt();
+
+    finalizeSimulator();
+
+    delete mem;
+    return 0;
+}
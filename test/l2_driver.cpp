@@ -0,0 +1,57 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <errno.h>
+#include "../src/MemoryStore.h"
+#include "../src/ProgramLoader.h"
+#include "../src/RegisterInfo.h"
+#include "../src/EndianHelpers.h"
+#include "../src/DriverFunctions.h"
+
+using namespace std;
+
+static MemoryStore *mem;
+
+int main(int argc, char **argv)
+{
+    if(argc != 2)
+    {
+        cout << "Usage: ./cycle_sim <file name>" << endl;
+        return -EINVAL;
+    }
+
+    mem = createMemoryStore();
+
+    if(loadProgram(argv[1], mem))
+    {
+        return -EBADF;
+    }
+
+    //Small L1s so that the L2 sees real traffic. The L1 miss latency is
+    //the L2 hit time; the L2 miss latency is the trip to memory.
+    CacheConfig icConfig;
+    icConfig.cacheSize = 256;
+    icConfig.blockSize = 32;
+    icConfig.type = DIRECT_MAPPED;
+    icConfig.missLatency = 4;
+    CacheConfig dcConfig = icConfig;
+
+    CacheConfig l2Config;
+    l2Config.cacheSize = 4096;
+    l2Config.blockSize = 64;
+    l2Config.type = SET_ASSOC;
+    l2Config.associativity = 4;
+    l2Config.missLatency = 20;
+    l2Config.inclusion = INCLUSIVE;
+
+    initSimulator(icConfig, dcConfig, &l2Config, 1, mem);
+
+    runCycles(10);
+
+    runTillHalt();
+
+    finalizeSimulator();
+
+    delete mem;
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <stdlib.h>
+#include <errno.h>
+#include "../src/MemoryStore.h"
+#include "../src/SparseMemoryStore.h"
+#include "../src/RegisterInfo.h"
+#include "../src/EndianHelpers.h"
+#include "../src/DriverFunctions.h"
+#include "../src/TraceFile.h"
+#include "../src/cache_sim.h"
+
+using namespace std;
+
+// Trace-driven cache study. Feeds a trace written by initTrace or by ./sim --trace straight into
+// an I-cache and a D-cache, without running the program, and prints their hits and misses as
+// sim_stats.out has them. A miss is made again once its data arrives, as the pipeline replays it.
+// A trace from initTrace is stamped in cycles, and each access is made at the cycle it gives, so
+// replaying it into the caches it was recorded with gives the simulator's own counts. One from
+// ./sim --trace is stamped in instructions, which say nothing of when a fill arrives, so its
+// accesses run on a clock of their own instead: one cycle each, plus the wait for each miss, as
+// warmCaches does. Memory contents play no part; the caches sit on an empty sparse store.
+//
+// The caches default to those of the 2-way driver: 1024, 64, 2way, 5. Types are direct, 2way,
+// Nway (N ways) and full.
+
+static void usage()
+{
+    cout << "Usage: ./replay <trace file> [--ic-size N] [--ic-block N] [--ic-type T] [--ic-latency N]" << endl
+         << "       [--dc-size N] [--dc-block N] [--dc-type T] [--dc-latency N]" << endl;
+}
+
+static int access(Cache *cache, const TraceRecord &record, uint32_t cycle)
+{
+    uint32_t value = 0;
+    MemEntrySize size = static_cast<MemEntrySize>(record.size);
+    if(record.kind == TRACE_WRITE)
+    {
+        return cache->setCacheValue(record.address, 0, size, cycle);
+    }
+    return cache->getCacheValue(record.address, value, size, cycle);
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+    {
+        usage();
+        return -EINVAL;
+    }
+
+    CacheConfig icConfig;
+    icConfig.cacheSize = 1024;
+    icConfig.blockSize = 64;
+    icConfig.type = TWO_WAY_SET_ASSOC;
+    icConfig.missLatency = 5;
+    CacheConfig dcConfig = icConfig;
+
+    for(int i = 2; i < argc; i += 2)
+    {
+        string option = argv[i];
+        bool icOption = option.compare(0, 5, "--ic-") == 0;
+        bool dcOption = option.compare(0, 5, "--dc-") == 0;
+        if(i + 1 >= argc || (!icOption && !dcOption))
+        {
+            usage();
+            return -EINVAL;
+        }
+
+        CacheConfig &config = icOption ? icConfig : dcConfig;
+        string field = option.substr(5);
+        uint32_t value = strtoul(argv[i + 1], nullptr, 0);
+        if(field == "size")
+        {
+            config.cacheSize = value;
+        }
+        else if(field == "block")
+        {
+            config.blockSize = value;
+        }
+        else if(field == "latency")
+        {
+            config.missLatency = value;
+        }
+        else if(field == "type")
+        {
+            if(!parseCacheType(argv[i + 1], config))
+            {
+                cout << "Unknown cache type " << argv[i + 1] << endl;
+                return -EINVAL;
+            }
+        }
+        else
+        {
+            usage();
+            return -EINVAL;
+        }
+    }
+
+    TraceReader trace;
+    if(trace.open(argv[1]))
+    {
+        return -EBADF;
+    }
+
+    SparseMemoryStore *mem = new SparseMemoryStore();
+    Cache *icache = new Cache(icConfig, mem);
+    Cache *dcache = new Cache(dcConfig, mem);
+
+    bool ownClock = trace.getClock() == TRACE_INSTRUCTIONS;
+    uint32_t clock = 0;
+    uint64_t records = 0;
+    TraceRecord record;
+    while(trace.next(record))
+    {
+        Cache *cache = record.kind == TRACE_FETCH ? icache : dcache;
+        uint32_t cycle = ownClock ? clock : record.cycle;
+        if(int delay = access(cache, record, cycle))
+        {
+            cycle += delay;
+            access(cache, record, cycle);
+        }
+        clock = cycle + 1;
+        records++;
+    }
+    if(trace.isTruncated())
+    {
+        cout << "Trace ends partway through a record" << endl;
+    }
+
+    cout << left << setw(20) << "Trace records:" << records << endl;
+    cout << left << setw(20) << "I-cache hits:" << icache->getHits() << endl;
+    cout << left << setw(20) << "I-cache misses:" << icache->getMisses() << endl;
+    cout << left << setw(20) << "D-cache hits:" << dcache->getHits() << endl;
+    cout << left << setw(20) << "D-cache misses:" << dcache->getMisses() << endl;
+
+    delete icache;
+    delete dcache;
+    delete mem;
+    return 0;
+}
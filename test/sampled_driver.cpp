@@ -0,0 +1,215 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <math.h>
+#include <stdlib.h>
+#include <errno.h>
+#include "../src/MemoryStore.h"
+#include "../src/FlatMemoryStore.h"
+#include "../src/RegisterInfo.h"
+#include "../src/EndianHelpers.h"
+#include "../src/DriverFunctions.h"
+#include "../src/cycle_sim.h"
+
+using namespace std;
+
+// Sampled simulation. Reads a plan from ./sim --simpoints (see SimPoint.h), run in the same
+// directory, and simulates each sampled interval in detail with the caches of the 2-way driver:
+// from its checkpoint, with the caches warmed by the interval before it, for as many instructions
+// as the interval holds. The samples run on a pool of threads, each on its own Simulator.
+//
+// Each cluster's cycles and cache counts per instruction are the mean over its samples, scaled by
+// the instructions it covers, and the whole run's are the sum over clusters. The bounds are 95%
+// ones from stratified sampling: a cluster's spread comes from its samples, shrunk as they cover
+// more of it. A cluster simulated in full has none; one with a single sample gives no spread to go
+// on, and is counted separately. Each sample starts with the pipeline empty, which costs a few
+// cycles against an interval of thousands.
+
+#define STAT_COUNT 5
+
+static const char *statNames[STAT_COUNT] = {"Total cycles:", "I-cache hits:", "I-cache misses:",
+                                             "D-cache hits:", "D-cache misses:"};
+
+struct Sample
+{
+    uint32_t cluster;
+    uint32_t interval;
+    uint64_t instructions;
+    string checkpoint;
+    string trace;
+    bool ok;
+    uint64_t retired;
+    double stats[STAT_COUNT];
+};
+
+struct Cluster
+{
+    uint64_t intervals;
+    uint64_t instructions;
+    vector<Sample *> samples;
+};
+
+static void simulate(Sample &sample)
+{
+    CacheConfig icConfig;
+    icConfig.cacheSize = 1024;
+    icConfig.blockSize = 64;
+    icConfig.type = TWO_WAY_SET_ASSOC;
+    icConfig.missLatency = 5;
+    CacheConfig dcConfig = icConfig;
+
+    FlatMemoryStore *mem = new FlatMemoryStore();
+    {
+        Simulator simulator;
+        sample.ok = simulator.restore(sample.checkpoint.c_str(), icConfig, dcConfig, mem) == 0 &&
+                    simulator.warmCaches(sample.trace.c_str()) == 0 &&
+                    simulator.runInstructions(sample.instructions) >= 0;
+        SimulationStats s = simulator.getStats();
+        sample.retired = simulator.getRetiredInstructions();
+        double counts[STAT_COUNT] = {(double) s.totalCycles, (double) s.icHits, (double) s.icMisses,
+                                     (double) s.dcHits, (double) s.dcMisses};
+        for(uint32_t i = 0; i < STAT_COUNT; i++)
+        {
+            sample.stats[i] = sample.retired ? counts[i] / sample.retired : 0;
+        }
+    }
+    delete mem;
+}
+
+int main(int argc, char **argv)
+{
+    if(argc != 2)
+    {
+        cout << "Usage: ./sampled <plan file>" << endl;
+        return -EINVAL;
+    }
+
+    ifstream planFile(argv[1]);
+    if(!planFile)
+    {
+        cout << "Could not read plan file " << argv[1] << endl;
+        return -EBADF;
+    }
+
+    uint64_t interval = 0, instructions = 0;
+    vector<Cluster> clusters;
+    vector<Sample> samples;
+    string line;
+    while(getline(planFile, line))
+    {
+        stringstream fields(line);
+        string kind;
+        fields >> kind;
+        if(kind == "interval")
+        {
+            fields >> interval;
+        }
+        else if(kind == "instructions")
+        {
+            fields >> instructions;
+        }
+        else if(kind == "cluster")
+        {
+            uint32_t id;
+            Cluster cluster{};
+            fields >> id >> cluster.intervals >> cluster.instructions;
+            clusters.resize(max<size_t>(clusters.size(), id + 1));
+            clusters[id] = cluster;
+        }
+        else if(kind == "sample")
+        {
+            Sample sample{};
+            fields >> sample.cluster >> sample.interval >> sample.instructions >> sample.checkpoint >> sample.trace;
+            samples.push_back(sample);
+        }
+        if(!fields || (!kind.empty() && kind != "interval" && kind != "instructions" && kind != "cluster" && kind != "sample") ||
+           (kind == "sample" && samples.back().cluster >= clusters.size()))
+        {
+            cout << "Could not make sense of plan line: " << line << endl;
+            return -EINVAL;
+        }
+    }
+
+    //Each worker takes the next sample not yet started.
+    atomic<size_t> next(0);
+    vector<thread> workers;
+    for(uint32_t i = 0; i < min<size_t>(max(thread::hardware_concurrency(), 1u), samples.size()); i++)
+    {
+        workers.emplace_back([&]()
+        {
+            for(size_t sample = next++; sample < samples.size(); sample = next++)
+            {
+                simulate(samples[sample]);
+            }
+        });
+    }
+    for(thread &worker : workers)
+    {
+        worker.join();
+    }
+
+    uint64_t sampled = 0;
+    for(Sample &sample : samples)
+    {
+        if(!sample.ok)
+        {
+            cout << "Could not simulate interval " << sample.interval << endl;
+            return -EINVAL;
+        }
+        clusters[sample.cluster].samples.push_back(&sample);
+        sampled += sample.retired;
+    }
+
+    double estimates[STAT_COUNT] = {};
+    double variances[STAT_COUNT] = {};
+    uint32_t unbounded = 0;
+    for(Cluster &cluster : clusters)
+    {
+        double n = cluster.samples.size();
+        if(n == 0)
+        {
+            continue;
+        }
+        unbounded += n == 1 && cluster.intervals > 1;
+        for(uint32_t i = 0; i < STAT_COUNT; i++)
+        {
+            double mean = 0, spread = 0;
+            for(Sample *sample : cluster.samples)
+            {
+                mean += sample->stats[i] / n;
+            }
+            for(Sample *sample : cluster.samples)
+            {
+                spread += (sample->stats[i] - mean) * (sample->stats[i] - mean);
+            }
+            estimates[i] += mean * cluster.instructions;
+            if(n > 1)
+            {
+                variances[i] += cluster.instructions * (double) cluster.instructions * (1 - n / cluster.intervals) *
+                                spread / (n - 1) / n;
+            }
+        }
+    }
+
+    cout << left << setw(24) << "Instructions:" << instructions << endl;
+    cout << left << setw(24) << "Simulated in detail:" << sampled << " in " << samples.size() << " intervals of "
+         << interval << ", from " << clusters.size() << " clusters" << endl;
+    cout << fixed << setprecision(0);
+    for(uint32_t i = 0; i < STAT_COUNT; i++)
+    {
+        cout << left << setw(24) << statNames[i] << estimates[i] << " +/- " << 1.96 * sqrt(variances[i]) << endl;
+    }
+    cout << setprecision(3);
+    cout << left << setw(24) << "CPI:" << (instructions ? estimates[0] / instructions : 0) << " +/- "
+         << (instructions ? 1.96 * sqrt(variances[0]) / instructions : 0) << endl;
+    if(unbounded)
+    {
+        cout << unbounded << " clusters had a single sample, so their spread is not in the bounds" << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,18 @@
+# Touches memory far outside the low 64 KB, for the sparse memory store (test/sparse_driver.cpp).
+main:   lui     $sp, 0x7fff
+        ori     $sp, $sp, 0xeffc        # $sp = 0x7FFFEFFC, near the top of the space
+        lui     $gp, 0x1000             # $gp = 0x10000000
+        addi    $t0, $zero, 1234        # $t0 = 0x000004D2
+        addi    $t1, $zero, -7          # $t1 = 0xFFFFFFF9
+        sw      $t0, 0($sp)             # M[0x7FFFEFFC] = 0x000004D2
+        sw      $t0, 0($gp)             # M[0x10000000] = 0x000004D2
+        sh      $t1, 8($gp)             # M[0x10000008] = 0xFFF9
+        sb      $t1, 4095($gp)          # M[0x10000FFF] = 0xF9, last byte of the page
+        lw      $t2, 0($sp)             # $t2 = 0x000004D2
+        lw      $t3, 0($gp)             # $t3 = 0x000004D2
+        lhu     $t4, 8($gp)             # $t4 = 0x0000FFF9
+        lbu     $t5, 4095($gp)          # $t5 = 0x000000F9
+        lw      $t6, 4096($gp)          # $t6 = 0, a page never written
+        lui     $t7, 0x4000
+        lw      $t7, 0($t7)             # $t7 = 0, a page table never written
+        .word   0xfeedfeed
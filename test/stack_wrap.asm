@@ -0,0 +1,9 @@
+# Stores below a stack pointer of 0, which wraps to the top of the address space, far past the
+# end of memory. The simulator must not crash filling or writing back the block they land in.
+main:   addi    $t0, $zero, 1234        # $t0 = 0x000004D2
+        addi    $sp, $sp, -16           # $sp = 0xFFFFFFF0
+        sw      $t0, 0($sp)             # M[0xFFFFFFF0] = 0x000004D2
+        sw      $t0, 12($sp)            # M[0xFFFFFFFC] = 0x000004D2, the last word there is
+        lw      $t1, 0($sp)
+        lw      $t2, 12($sp)
+        .word   0xfeedfeed
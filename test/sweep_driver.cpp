@@ -0,0 +1,287 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "../src/MemoryStore.h"
+#include "../src/FlatMemoryStore.h"
+#include "../src/ProgramLoader.h"
+#include "../src/RegisterInfo.h"
+#include "../src/EndianHelpers.h"
+#include "../src/DriverFunctions.h"
+#include "../src/cycle_sim.h"
+
+using namespace std;
+
+// Design-space sweep. Runs a program once for every combination of the I- and D-cache
+// parameters given, spread over a pool of threads, each run with its own Simulator and its own
+// copy of memory. Prints one CSV line (or JSON object) per configuration, in grid order, with
+// the statistics finalizeSimulator would print. No pipe dumps are written; with --reports, each
+// run's finalize reports go to a directory of their own, numbered from 1 in output order.
+//
+// Every parameter takes a comma-separated list. Cache types are direct, 2way, Nway (N ways)
+// and full. Defaults are those of the 2-way driver: 1024, 64, 2way, 5.
+
+struct CacheAxis
+{
+    vector<uint32_t> sizes{1024};
+    vector<uint32_t> blocks{64};
+    vector<string> types{"2way"};
+    vector<uint32_t> latencies{5};
+};
+
+struct SweepRun
+{
+    CacheConfig icConfig;
+    CacheConfig dcConfig;
+    string icType;
+    string dcType;
+    bool halted;
+    SimulationStats stats;
+};
+
+static vector<string> splitList(const char *list)
+{
+    vector<string> items;
+    stringstream stream(list);
+    string item;
+    while(getline(stream, item, ','))
+    {
+        items.push_back(item);
+    }
+    return items;
+}
+
+static vector<uint32_t> parseNumbers(const char *list)
+{
+    vector<uint32_t> numbers;
+    for(const string &item : splitList(list))
+    {
+        numbers.push_back(strtoul(item.c_str(), nullptr, 0));
+    }
+    return numbers;
+}
+
+static bool powerOfTwo(uint32_t value)
+{
+    return value && !(value & (value - 1));
+}
+
+// every combination of the axis, in order, leaving out block sizes that do not fit the cache
+static vector<pair<CacheConfig, string>> expandAxis(const CacheAxis &axis)
+{
+    vector<pair<CacheConfig, string>> configs;
+    for(uint32_t size : axis.sizes)
+    {
+        for(uint32_t block : axis.blocks)
+        {
+            for(const string &type : axis.types)
+            {
+                for(uint32_t latency : axis.latencies)
+                {
+                    CacheConfig config;
+                    config.cacheSize = size;
+                    config.blockSize = block;
+                    config.missLatency = latency;
+                    parseCacheType(type.c_str(), config);
+                    if(powerOfTwo(size) && powerOfTwo(block) && block <= size)
+                    {
+                        configs.push_back({config, type});
+                    }
+                }
+            }
+        }
+    }
+    return configs;
+}
+
+static void simulate(const FlatMemoryStore &image, SweepRun &run, uint32_t maxCycles, const string &reportDirectory)
+{
+    FlatMemoryStore *mem = new FlatMemoryStore(image);
+    {
+        Simulator simulator;
+        simulator.init(run.icConfig, run.dcConfig, mem);
+        if(maxCycles)
+        {
+            run.halted = simulator.runCycles(maxCycles) == 1;
+        }
+        else
+        {
+            run.halted = simulator.runTillHalt() == 0;
+        }
+        run.stats = simulator.getStats();
+        if(!reportDirectory.empty() && mkdir(reportDirectory.c_str(), 0755) == 0)
+        {
+            simulator.setReportDirectory(reportDirectory);
+            simulator.finalize();
+        }
+    }
+    delete mem;
+}
+
+static void printRun(const SweepRun &run, bool json)
+{
+    const SimulationStats &s = run.stats;
+    if(json)
+    {
+        cout << "{\"ic_size\": " << run.icConfig.cacheSize << ", \"ic_block\": " << run.icConfig.blockSize
+             << ", \"ic_type\": \"" << run.icType << "\", \"ic_latency\": " << run.icConfig.missLatency
+             << ", \"dc_size\": " << run.dcConfig.cacheSize << ", \"dc_block\": " << run.dcConfig.blockSize
+             << ", \"dc_type\": \"" << run.dcType << "\", \"dc_latency\": " << run.dcConfig.missLatency
+             << ", \"halted\": " << (run.halted ? "true" : "false") << ", \"total_cycles\": " << s.totalCycles
+             << ", \"ic_hits\": " << s.icHits << ", \"ic_misses\": " << s.icMisses
+             << ", \"dc_hits\": " << s.dcHits << ", \"dc_misses\": " << s.dcMisses << "}" << endl;
+        return;
+    }
+    cout << run.icConfig.cacheSize << "," << run.icConfig.blockSize << "," << run.icType << "," << run.icConfig.missLatency << ","
+         << run.dcConfig.cacheSize << "," << run.dcConfig.blockSize << "," << run.dcType << "," << run.dcConfig.missLatency << ","
+         << run.halted << "," << s.totalCycles << "," << s.icHits << "," << s.icMisses << ","
+         << s.dcHits << "," << s.dcMisses << endl;
+}
+
+static void usage()
+{
+    cout << "Usage: ./sweep <file name> [--ic-size L] [--ic-block L] [--ic-type L] [--ic-latency L]" << endl
+         << "       [--dc-size L] [--dc-block L] [--dc-type L] [--dc-latency L]" << endl
+         << "       [--threads N] [--max-cycles N] [--reports DIR] [--json]" << endl
+         << "Each L is a comma-separated list; types are direct, 2way, Nway and full." << endl;
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+    {
+        usage();
+        return -EINVAL;
+    }
+
+    CacheAxis icAxis, dcAxis;
+    uint32_t threads = max(thread::hardware_concurrency(), 1u);
+    uint32_t maxCycles = 0;
+    string reports;
+    bool json = false;
+    for(int i = 2; i < argc; i++)
+    {
+        string option = argv[i];
+        if(option == "--json")
+        {
+            json = true;
+            continue;
+        }
+        if(i + 1 >= argc)
+        {
+            usage();
+            return -EINVAL;
+        }
+
+        const char *value = argv[++i];
+        bool icOption = option.compare(0, 5, "--ic-") == 0;
+        bool dcOption = option.compare(0, 5, "--dc-") == 0;
+        CacheAxis &axis = dcOption ? dcAxis : icAxis;
+        string field = icOption || dcOption ? option.substr(5) : "";
+        if(option == "--threads")
+        {
+            threads = max(atoi(value), 1);
+        }
+        else if(option == "--max-cycles")
+        {
+            maxCycles = strtoul(value, nullptr, 0);
+        }
+        else if(option == "--reports")
+        {
+            reports = value;
+        }
+        else if(field == "size")
+        {
+            axis.sizes = parseNumbers(value);
+        }
+        else if(field == "block")
+        {
+            axis.blocks = parseNumbers(value);
+        }
+        else if(field == "latency")
+        {
+            axis.latencies = parseNumbers(value);
+        }
+        else if(field == "type")
+        {
+            axis.types = splitList(value);
+            for(const string &type : axis.types)
+            {
+                CacheConfig config;
+                if(!parseCacheType(type.c_str(), config))
+                {
+                    cout << "Unknown cache type " << type << endl;
+                    return -EINVAL;
+                }
+            }
+        }
+        else
+        {
+            usage();
+            return -EINVAL;
+        }
+    }
+
+    //Loaded once; every run starts from a copy.
+    FlatMemoryStore *image = new FlatMemoryStore();
+    if(loadProgram(argv[1], image))
+    {
+        delete image;
+        return -EBADF;
+    }
+
+    vector<SweepRun> runs;
+    for(auto &ic : expandAxis(icAxis))
+    {
+        for(auto &dc : expandAxis(dcAxis))
+        {
+            runs.push_back(SweepRun{ic.first, dc.first, ic.second, dc.second, false, SimulationStats{}});
+        }
+    }
+
+    if(!reports.empty() && mkdir(reports.c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        cout << "Could not create report directory " << reports << endl;
+        delete image;
+        return -EINVAL;
+    }
+
+    //Each worker takes the next run not yet started.
+    atomic<size_t> next(0);
+    vector<thread> workers;
+    for(uint32_t i = 0; i < min<size_t>(threads, runs.size()); i++)
+    {
+        workers.emplace_back([&]()
+        {
+            for(size_t run = next++; run < runs.size(); run = next++)
+            {
+                simulate(*image, runs[run], maxCycles, reports.empty() ? "" : reports + "/" + to_string(run + 1));
+            }
+        });
+    }
+    for(thread &worker : workers)
+    {
+        worker.join();
+    }
+
+    if(!json)
+    {
+        cout << "ic_size,ic_block,ic_type,ic_latency,dc_size,dc_block,dc_type,dc_latency,"
+             << "halted,total_cycles,ic_hits,ic_misses,dc_hits,dc_misses" << endl;
+    }
+    for(const SweepRun &run : runs)
+    {
+        printRun(run, json);
+    }
+
+    delete image;
+    return 0;
+}
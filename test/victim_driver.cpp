@@ -0,0 +1,56 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <errno.h>
+#include "../src/MemoryStore.h"
+#include "../src/ProgramLoader.h"
+#include "../src/RegisterInfo.h"
+#include "../src/EndianHelpers.h"
+#include "../src/DriverFunctions.h"
+
+using namespace std;
+
+static MemoryStore *mem;
+
+int main(int argc, char **argv)
+{
+    if(argc != 2)
+    {
+        cout << "Usage: ./cycle_sim <file name>" << endl;
+        return -EINVAL;
+    }
+
+    mem = createMemoryStore();
+
+    if(loadProgram(argv[1], mem))
+    {
+        return -EBADF;
+    }
+
+    CacheConfig icConfig;
+    icConfig.cacheSize = 1024;
+    icConfig.blockSize = 64;
+    icConfig.type = TWO_WAY_SET_ASSOC;
+    icConfig.missLatency = 6;
+
+    CacheConfig dcConfig;
+    dcConfig.cacheSize = 2048;
+    dcConfig.blockSize = 64;
+    dcConfig.type = DIRECT_MAPPED;
+    dcConfig.missLatency = 2;
+    //Conflict victims stay in a 4-block victim cache, and dirty ones drain from a write buffer.
+    dcConfig.victimBlocks = 4;
+    dcConfig.writebackLatency = 4;
+    dcConfig.writeBufferEntries = 2;
+
+    initSimulator(icConfig, dcConfig, mem);
+
+    runCycles(10);
+
+    runTillHalt();
+
+    finalizeSimulator();
+
+    delete mem;
+    return 0;
+}